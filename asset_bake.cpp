@@ -0,0 +1,92 @@
+// Offline asset pack baker.
+//
+// Decodes textures to RGBA8 and writes them, with full mip chains, into one
+// pack file (see asset_pack.h) that the game maps at startup instead of
+// decoding PNGs. With no file arguments it bakes textures/*.png and, if it
+// has been baked, the sprite atlas.
+//
+// Build: g++ -O2 asset_bake.cpp asset_pack.cpp -I. -o asset_bake
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "asset_pack.h"
+
+namespace fs = std::filesystem;
+
+const char* DEFAULT_PACK_PATH = "textures/assets.pack";
+
+int main(int argc, char** argv) {
+    std::string outputPath = DEFAULT_PACK_PATH;
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+            outputPath = argv[++i];
+        } else if (argv[i][0] == '-') {
+            std::cerr << "Usage: " << argv[0] << " [--output FILE] [TEXTURE...]\n";
+            return -1;
+        } else {
+            paths.push_back(argv[i]);
+        }
+    }
+
+    // Keys are the paths exactly as the game asks for them
+    if (paths.empty()) {
+        std::error_code error;
+        for (const fs::directory_entry& entry : fs::directory_iterator("textures", error)) {
+            if (entry.is_regular_file() && entry.path().extension() == ".png")
+                paths.push_back("textures/" + entry.path().filename().string());
+        }
+        std::sort(paths.begin(), paths.end());
+        if (fs::exists("textures/atlas/atlas.tga"))
+            paths.push_back("textures/atlas/atlas.tga");
+    }
+    if (paths.empty()) {
+        std::cerr << "No textures to bake\n";
+        return -1;
+    }
+
+    // Same orientation as the game's stbi_set_flip_vertically_on_load(true)
+    stbi_set_flip_vertically_on_load(true);
+    std::vector<PackImage> images;
+    size_t sourceBytes = 0;
+    for (const std::string& path : paths) {
+        std::ifstream file(path, std::ios::binary);
+        std::vector<unsigned char> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        int channels;
+        PackImage image;
+        unsigned char* pixels = stbi_load_from_memory(bytes.data(), (int)bytes.size(), &image.width, &image.height, &channels, 4);
+        if (!file || !pixels) {
+            std::cerr << "Failed to load " << path << "\n";
+            return -1;
+        }
+        image.path = path;
+        image.contentHash = hashContent(bytes.data(), bytes.size());
+        image.rgba.assign(pixels, pixels + (size_t)image.width * image.height * 4);
+        stbi_image_free(pixels);
+        sourceBytes += bytes.size();
+        images.push_back(std::move(image));
+    }
+
+    if (!writeAssetPack(outputPath, images))
+        return -1;
+
+    AssetPack pack;
+    if (!pack.open(outputPath))
+        return -1;
+    size_t packBytes = 0;
+    for (const std::string& path : paths)
+        packBytes += pack.find(path)->bytes();
+    std::cout << "Baked " << images.size() << " textures (" << sourceBytes / 1024 << " KiB compressed) into "
+              << outputPath << " (" << packBytes / 1024 << " KiB of pixels with mips)\n";
+    return 0;
+}
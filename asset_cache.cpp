@@ -0,0 +1,310 @@
+#include "asset_cache.h"
+
+#include <glad/glad.h>
+#include <stb_image.h>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+#include "asset_pack.h"
+#include "cpu_profiler.h"
+
+TextureCache::~TextureCache() {
+    joinWorkers();
+    for (Decoded& job : jobs_)
+        stbi_image_free(job.pixels);
+    // Textures still acquired; the cache must go before the GL context
+    for (Entry& entry : entries_) {
+        if (entry.texture)
+            glDeleteTextures(1, &entry.texture);
+    }
+    dropPixels();
+}
+
+void TextureCache::decode(Decoded& image) {
+    PROFILE_ZONE("decode texture");
+    std::ifstream file(image.path, std::ios::binary);
+    if (!file)
+        return;
+    std::vector<unsigned char> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    image.contentHash = hashContent(bytes.data(), bytes.size());
+    image.pixels = stbi_load_from_memory(bytes.data(), (int)bytes.size(), &image.width, &image.height, &image.channels, 0);
+    image.ok = image.pixels != nullptr;
+}
+
+void TextureCache::prefetch(const std::vector<std::string>& paths) {
+    jobs_.resize(paths.size());
+    uploaded_.assign(paths.size(), false);
+    for (size_t i = 0; i < paths.size(); i++)
+        jobs_[i].path = paths[i];
+
+    size_t threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = std::min(threads, paths.size());
+    auto start = std::chrono::steady_clock::now();
+    for (size_t t = 0; t < threads; t++) {
+        workers_.emplace_back([this, start] {
+            PROFILE_THREAD("texture decode");
+            for (;;) {
+                size_t job;
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    if (nextJob_ == jobs_.size())
+                        return;
+                    job = nextJob_++;
+                }
+                decode(jobs_[job]);
+                std::lock_guard<std::mutex> lock(mutex_);
+                finished_.push_back(job);
+                prefetchSeconds_ = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                jobDone_.notify_one();
+            }
+        });
+    }
+}
+
+const TextureCache::Decoded* TextureCache::drainPrefetch(const std::string& path) {
+    size_t target = jobs_.size();
+    for (size_t i = 0; i < jobs_.size(); i++) {
+        if (jobs_[i].path == path)
+            target = i;
+    }
+    if (target == jobs_.size())
+        return nullptr;
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        while (!finished_.empty()) {
+            size_t job = finished_.front();
+            finished_.erase(finished_.begin());
+            // GL calls happen outside the lock so workers keep going
+            lock.unlock();
+            decodes_ += jobs_[job].ok;
+            upload(jobs_[job]);
+            uploaded_[job] = true;
+            uploadedCount_++;
+            lock.lock();
+        }
+        if (uploaded_[target])
+            break;
+        jobDone_.wait(lock);
+    }
+    lock.unlock();
+    if (uploadedCount_ == jobs_.size())
+        joinWorkers();
+    return &jobs_[target];
+}
+
+void TextureCache::joinWorkers() {
+    for (std::thread& worker : workers_)
+        worker.join();
+    workers_.clear();
+}
+
+TextureCache::Entry* TextureCache::upload(Decoded& image) {
+    if (!image.ok) {
+        std::cerr << "Failed to load texture: " << image.path << "\n";
+        return nullptr;
+    }
+
+    // Same image under another name
+    for (Entry& entry : entries_) {
+        if (entry.texture && entry.contentHash == image.contentHash) {
+            entry.paths.push_back(image.path);
+            stbi_image_free(image.pixels);
+            image.pixels = nullptr;
+            return &entry;
+        }
+    }
+
+    unsigned int textureID;
+    glGenTextures(1, &textureID);
+    GLenum format = image.channels == 4 ? GL_RGBA : GL_RGB;
+    glBindTexture(GL_TEXTURE_2D, textureID);
+    glTexImage2D(GL_TEXTURE_2D, 0, format, image.width, image.height, 0, format, GL_UNSIGNED_BYTE, image.pixels);
+    glGenerateMipmap(GL_TEXTURE_2D);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    Entry entry;
+    if (keepPixels_)
+        entry.pixels = image.pixels;
+    else
+        stbi_image_free(image.pixels);
+    image.pixels = nullptr;
+    entry.paths.push_back(image.path);
+    entry.contentHash = image.contentHash;
+    entry.texture = textureID;
+    entry.width = image.width;
+    entry.height = image.height;
+    entry.channels = image.channels;
+    entry.decodedBytes = (size_t)image.width * image.height * image.channels;
+    // Drivers pad RGB to 4 bytes per texel; a full mip chain adds about a third
+    entry.vramBytes = (size_t)image.width * image.height * 4 * 4 / 3;
+
+    return addEntry(entry);
+}
+
+TextureCache::Entry* TextureCache::uploadPacked(const PackedTexture& texture) {
+    for (Entry& entry : entries_) {
+        if (entry.texture && entry.contentHash == texture.contentHash) {
+            entry.paths.push_back(texture.path);
+            return &entry;
+        }
+    }
+
+    unsigned int textureID;
+    glGenTextures(1, &textureID);
+    glBindTexture(GL_TEXTURE_2D, textureID);
+    // Rows are tightly packed RGBA8, so the default unpack alignment of 4 holds
+    int levels = (int)texture.levels.size();
+    for (int l = 0; l < levels; l++) {
+        glTexImage2D(GL_TEXTURE_2D, l, GL_RGBA, texture.levelWidth(l), texture.levelHeight(l), 0,
+                     GL_RGBA, GL_UNSIGNED_BYTE, texture.levels[l]);
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    Entry entry;
+    entry.paths.push_back(texture.path);
+    entry.contentHash = texture.contentHash;
+    entry.texture = textureID;
+    entry.width = texture.width;
+    entry.height = texture.height;
+    entry.channels = 4;
+    entry.vramBytes = texture.bytes();
+    entry.packed = true;
+    if (keepPixels_)
+        entry.packedSource = &texture;
+    return addEntry(entry);
+}
+
+TextureCache::Entry* TextureCache::addEntry(const Entry& entry) {
+    // Reuse a released slot if there is one
+    for (Entry& slot : entries_) {
+        if (!slot.texture) {
+            slot = entry;
+            return &slot;
+        }
+    }
+    entries_.push_back(entry);
+    return &entries_.back();
+}
+
+TextureCache::Entry* TextureCache::findByPath(const std::string& path) {
+    for (Entry& entry : entries_) {
+        for (const std::string& p : entry.paths) {
+            if (p == path)
+                return &entry;
+        }
+    }
+    return nullptr;
+}
+
+TextureCache::Entry* TextureCache::findByTexture(unsigned int texture) {
+    for (Entry& entry : entries_) {
+        if (entry.texture == texture)
+            return &entry;
+    }
+    return nullptr;
+}
+
+unsigned int TextureCache::acquire(const std::string& path) {
+    requests_++;
+    Entry* entry = findByPath(path);
+    if (!entry && pack_) {
+        if (const PackedTexture* packed = pack_->find(path))
+            entry = uploadPacked(*packed);
+    }
+    if (!entry) {
+        const Decoded* prefetched = drainPrefetch(path);
+        entry = findByPath(path);
+        if (!entry && prefetched && !prefetched->ok)
+            return 0; // already reported
+    }
+    if (!entry) {
+        // Not packed or prefetched (or already released); decode here
+        Decoded image;
+        image.path = path;
+        decode(image);
+        decodes_ += image.ok;
+        entry = upload(image);
+        if (!entry)
+            return 0;
+    }
+    entry->refCount++;
+    return entry->texture;
+}
+
+void TextureCache::release(unsigned int texture) {
+    Entry* entry = findByTexture(texture);
+    if (!entry || entry->refCount == 0)
+        return;
+    if (--entry->refCount == 0) {
+        glDeleteTextures(1, &entry->texture);
+        stbi_image_free(entry->pixels);
+        *entry = Entry();
+    }
+}
+
+bool TextureCache::pixels(const std::string& path, TexturePixels& out) {
+    Entry* entry = findByPath(path);
+    if (!entry || !entry->texture)
+        return false;
+    out = TexturePixels();
+    out.width = entry->width;
+    out.height = entry->height;
+    out.channels = entry->channels;
+    if (entry->packedSource) {
+        out.levels = entry->packedSource->levels;
+    } else if (entry->pixels) {
+        out.levels.push_back(entry->pixels);
+    } else {
+        std::cerr << "Texture pixels were not kept: " << path << "\n";
+        return false;
+    }
+    return true;
+}
+
+void TextureCache::dropPixels() {
+    for (Entry& entry : entries_) {
+        stbi_image_free(entry.pixels);
+        entry.pixels = nullptr;
+        entry.packedSource = nullptr;
+    }
+}
+
+void TextureCache::report(std::ostream& out) const {
+    size_t decoded = 0, vram = 0;
+    int live = 0;
+    for (const Entry& entry : entries_) {
+        if (!entry.texture)
+            continue;
+        live++;
+        decoded += entry.decodedBytes;
+        vram += entry.vramBytes;
+        out << "  " << entry.paths[0];
+        for (size_t i = 1; i < entry.paths.size(); i++)
+            out << " = " << entry.paths[i];
+        out << ": " << entry.width << "x" << entry.height << "x" << entry.channels << ", " << entry.refCount
+            << (entry.refCount == 1 ? " user, " : " users, ");
+        if (entry.packed)
+            out << "from pack, ";
+        else
+            out << entry.decodedBytes / 1024 << " KiB decoded, ";
+        out << entry.vramBytes / 1024 << " KiB VRAM\n";
+    }
+    out << "Textures: " << live << " unique for " << requests_ << " requests (" << decodes_ << " decoded), "
+        << decoded / (1024 * 1024) << " MiB decoded, " << vram / (1024 * 1024) << " MiB VRAM\n";
+    if (!jobs_.empty())
+        out << "Prefetch: " << jobs_.size() << " files decoded in " << prefetchSeconds_ * 1000.0 << " ms\n";
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+// Shared GPU textures keyed by file path and by content hash.
+//
+// acquire() returns the same GL texture for repeated requests of one path,
+// and also for different paths whose files have identical bytes, so each
+// image is decoded and uploaded once. Textures are reference counted and
+// deleted when the last user releases them, or with the cache, which must
+// therefore be destroyed while the GL context is still current.
+//
+// prefetch() decodes files on worker threads before there is a GL context;
+// acquire() then uploads finished decodes on the calling (GL) thread in the
+// order they complete, waiting only for the one it was asked for.
+//
+// With a baked pack set, textures it contains are uploaded straight from the
+// pack's mapping with their stored mips and never decoded.
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+class AssetPack;
+struct PackedTexture;
+
+// CPU-side pixels behind a cached texture, bottom row first. Decoded files
+// have level 0 only, in their own channel count; packed textures are RGBA8
+// with their whole mip chain.
+struct TexturePixels {
+    int width = 0, height = 0, channels = 0;
+    std::vector<const unsigned char*> levels;
+};
+
+class TextureCache {
+public:
+    TextureCache() = default;
+    TextureCache(const TextureCache&) = delete;
+    TextureCache& operator=(const TextureCache&) = delete;
+    ~TextureCache();
+
+    // Serve textures from this pack when it has them; the pack must outlive
+    // every acquire() call, and every pixels() call too if keepPixels is set
+    void setPack(const AssetPack* pack) { pack_ = pack; }
+    // Hold on to decoded pixels after upload so pixels() can hand them out.
+    // Set before prefetch().
+    void setKeepPixels(bool keep) { keepPixels_ = keep; }
+
+    // Start decoding these files in the background; needs no GL context.
+    // stbi_set_flip_vertically_on_load must already be set. Call once.
+    void prefetch(const std::vector<std::string>& paths);
+
+    // Load (or share) a texture; needs a current GL context. Returns 0 and
+    // prints an error if the file cannot be read or decoded.
+    unsigned int acquire(const std::string& path);
+    void release(unsigned int texture);
+
+    // Pixels of an acquired path, valid until it is released or
+    // dropPixels() runs. Returns false unless keepPixels was set.
+    bool pixels(const std::string& path, TexturePixels& out);
+    // Free every kept decode
+    void dropPixels();
+
+    // Per-asset and total decoded/VRAM bytes, plus how many requests were
+    // served without decoding
+    void report(std::ostream& out) const;
+
+private:
+    struct Entry {
+        std::vector<std::string> paths; // every path that resolved here
+        uint64_t contentHash = 0;
+        unsigned int texture = 0;       // 0 marks a free slot
+        int refCount = 0;
+        int width = 0, height = 0, channels = 0;
+        size_t decodedBytes = 0;
+        size_t vramBytes = 0; // estimate, including the mip chain
+        bool packed = false;  // uploaded from the pack, not decoded
+        // Kept when keepPixels is set: the decode (owned) or the pack entry
+        unsigned char* pixels = nullptr;
+        const PackedTexture* packedSource = nullptr;
+    };
+
+    // A file read and decoded to pixels, not yet on the GPU
+    struct Decoded {
+        std::string path;
+        bool ok = false;
+        uint64_t contentHash = 0;
+        unsigned char* pixels = nullptr;
+        int width = 0, height = 0, channels = 0;
+    };
+
+    static void decode(Decoded& image);
+    // Adds image as an entry with no users, or shares an identical one
+    Entry* upload(Decoded& image);
+    // Upload every finished prefetch, waiting until path's is in. Returns its
+    // job, or nullptr if path was not prefetched.
+    const Decoded* drainPrefetch(const std::string& path);
+    Entry* uploadPacked(const PackedTexture& texture);
+    Entry* addEntry(const Entry& entry);
+    void joinWorkers();
+
+    Entry* findByPath(const std::string& path);
+    Entry* findByTexture(unsigned int texture);
+
+    const AssetPack* pack_ = nullptr;
+    bool keepPixels_ = false;
+    std::vector<Entry> entries_;
+    int requests_ = 0;
+    int decodes_ = 0;
+
+    // Prefetch jobs; workers take indices from nextJob_ and push them to
+    // finished_ when done
+    std::vector<Decoded> jobs_;
+    std::vector<bool> uploaded_;
+    size_t nextJob_ = 0;
+    std::vector<size_t> finished_;
+    size_t uploadedCount_ = 0;
+    std::mutex mutex_;
+    std::condition_variable jobDone_;
+    std::vector<std::thread> workers_;
+    double prefetchSeconds_ = 0.0; // wall time until the last decode finished
+};
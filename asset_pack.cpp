@@ -0,0 +1,213 @@
+#include "asset_pack.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace {
+
+const char PACK_MAGIC[4] = { 'M', 'B', 'A', 'P' };
+const uint16_t PACK_VERSION = 1;
+const size_t PACK_ALIGNMENT = 64;
+
+void put(std::vector<unsigned char>& out, uint64_t value, int bytes) {
+    for (int i = 0; i < bytes; i++)
+        out.push_back((unsigned char)(value >> (8 * i)));
+}
+
+uint64_t get(const unsigned char*& in, int bytes) {
+    uint64_t value = 0;
+    for (int i = 0; i < bytes; i++)
+        value |= (uint64_t)in[i] << (8 * i);
+    in += bytes;
+    return value;
+}
+
+int mipLevelCount(int width, int height) {
+    int levels = 1;
+    while (width > 1 || height > 1) {
+        width = width > 1 ? width / 2 : 1;
+        height = height > 1 ? height / 2 : 1;
+        levels++;
+    }
+    return levels;
+}
+
+// 2x2 box filter; an odd last row or column folds into its neighbour's texel
+std::vector<unsigned char> downsample(const std::vector<unsigned char>& src, int width, int height) {
+    int w = width > 1 ? width / 2 : 1;
+    int h = height > 1 ? height / 2 : 1;
+    std::vector<unsigned char> dst((size_t)w * h * 4);
+    for (int y = 0; y < h; y++) {
+        int y0 = std::min(2 * y, height - 1), y1 = std::min(2 * y + 1, height - 1);
+        for (int x = 0; x < w; x++) {
+            int x0 = std::min(2 * x, width - 1), x1 = std::min(2 * x + 1, width - 1);
+            for (int c = 0; c < 4; c++) {
+                int sum = src[((size_t)y0 * width + x0) * 4 + c] + src[((size_t)y0 * width + x1) * 4 + c] +
+                          src[((size_t)y1 * width + x0) * 4 + c] + src[((size_t)y1 * width + x1) * 4 + c];
+                dst[((size_t)y * w + x) * 4 + c] = (unsigned char)((sum + 2) / 4);
+            }
+        }
+    }
+    return dst;
+}
+
+}
+
+uint64_t hashContent(const unsigned char* data, size_t size) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= data[i];
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+size_t PackedTexture::bytes() const {
+    size_t total = 0;
+    for (int l = 0; l < (int)levels.size(); l++)
+        total += (size_t)levelWidth(l) * levelHeight(l) * 4;
+    return total;
+}
+
+bool AssetPack::open(const std::string& path) {
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "Failed to open asset pack: " << path << "\n";
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size < 12) {
+        std::cerr << "Asset pack is too short: " << path << "\n";
+        ::close(fd);
+        return false;
+    }
+    mappedBytes_ = (size_t)info.st_size;
+    void* mapping = mmap(nullptr, mappedBytes_, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        std::cerr << "Failed to map asset pack: " << path << "\n";
+        mappedBytes_ = 0;
+        return false;
+    }
+    mapping_ = mapping;
+
+    const unsigned char* base = (const unsigned char*)mapping_;
+    const unsigned char* end = base + mappedBytes_;
+    const unsigned char* in = base;
+    if (memcmp(in, PACK_MAGIC, 4) != 0) {
+        std::cerr << "Not an asset pack: " << path << "\n";
+        close();
+        return false;
+    }
+    in += 4;
+    uint16_t version = (uint16_t)get(in, 2);
+    if (version != PACK_VERSION) {
+        std::cerr << "Unsupported asset pack version " << version << ": " << path << "\n";
+        close();
+        return false;
+    }
+    get(in, 2);
+    uint32_t count = (uint32_t)get(in, 4);
+
+    for (uint32_t i = 0; i < count; i++) {
+        bool ok = end - in >= 2;
+        size_t pathLength = ok ? (size_t)get(in, 2) : 0;
+        ok = ok && (size_t)(end - in) >= pathLength + 28;
+        PackedTexture texture;
+        uint64_t offset = 0;
+        int levels = 0;
+        if (ok) {
+            texture.path.assign((const char*)in, pathLength);
+            in += pathLength;
+            texture.contentHash = get(in, 8);
+            texture.width = (int)get(in, 4);
+            texture.height = (int)get(in, 4);
+            levels = (int)get(in, 4);
+            offset = get(in, 8);
+            ok = texture.width > 0 && texture.height > 0 && levels > 0 &&
+                 levels <= mipLevelCount(texture.width, texture.height);
+        }
+        for (int l = 0; ok && l < levels; l++) {
+            size_t levelBytes = (size_t)texture.levelWidth(l) * texture.levelHeight(l) * 4;
+            // Written so a corrupt offset cannot wrap past the check
+            ok = offset <= mappedBytes_ && levelBytes <= mappedBytes_ - offset;
+            texture.levels.push_back(base + offset);
+            offset += levelBytes;
+        }
+        if (!ok) {
+            std::cerr << "Asset pack index is corrupt at entry " << i << ": " << path << "\n";
+            close();
+            return false;
+        }
+        textures_.push_back(texture);
+    }
+    return true;
+}
+
+void AssetPack::close() {
+    if (mapping_)
+        munmap(mapping_, mappedBytes_);
+    mapping_ = nullptr;
+    mappedBytes_ = 0;
+    textures_.clear();
+}
+
+const PackedTexture* AssetPack::find(const std::string& path) const {
+    for (const PackedTexture& texture : textures_) {
+        if (texture.path == path)
+            return &texture;
+    }
+    return nullptr;
+}
+
+bool writeAssetPack(const std::string& path, const std::vector<PackImage>& images) {
+    std::vector<unsigned char> index(PACK_MAGIC, PACK_MAGIC + 4);
+    put(index, PACK_VERSION, 2);
+    put(index, 0, 2);
+    put(index, images.size(), 4);
+    size_t indexBytes = index.size();
+    for (const PackImage& image : images)
+        indexBytes += 2 + image.path.size() + 28;
+
+    // Level data for every image, each image aligned
+    std::vector<unsigned char> data;
+    size_t dataStart = (indexBytes + PACK_ALIGNMENT - 1) / PACK_ALIGNMENT * PACK_ALIGNMENT;
+    for (const PackImage& image : images) {
+        data.resize((data.size() + PACK_ALIGNMENT - 1) / PACK_ALIGNMENT * PACK_ALIGNMENT, 0);
+        int levels = mipLevelCount(image.width, image.height);
+        put(index, image.path.size(), 2);
+        index.insert(index.end(), image.path.begin(), image.path.end());
+        put(index, image.contentHash, 8);
+        put(index, image.width, 4);
+        put(index, image.height, 4);
+        put(index, levels, 4);
+        put(index, dataStart + data.size(), 8);
+
+        std::vector<unsigned char> level = image.rgba;
+        int w = image.width, h = image.height;
+        for (int l = 0; l < levels; l++) {
+            data.insert(data.end(), level.begin(), level.end());
+            if (l + 1 < levels) {
+                level = downsample(level, w, h);
+                w = w > 1 ? w / 2 : 1;
+                h = h > 1 ? h / 2 : 1;
+            }
+        }
+    }
+    index.resize(dataStart, 0);
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file.write((const char*)index.data(), index.size()) || !file.write((const char*)data.data(), data.size())) {
+        std::cerr << "Failed to write asset pack: " << path << "\n";
+        return false;
+    }
+    return true;
+}
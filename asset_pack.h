@@ -0,0 +1,70 @@
+#pragma once
+
+// Baked texture pack: every texture already decoded to RGBA8, flipped to
+// GL's bottom-row-first order, with its full mip chain, so the game can
+// upload straight from a memory mapping with no PNG inflate and no
+// glGenerateMipmap. asset_bake.cpp writes it.
+//
+// File layout (little-endian, version 1):
+//   char[4] magic "MBAP"
+//   u16     version
+//   u16     reserved
+//   u32     texture count
+//   index, per texture:
+//     u16   path length, then the path bytes (the path the game loads)
+//     u64   content hash of the source file (hashContent)
+//     u32   width, u32 height, u32 mip level count
+//     u64   file offset of level 0; later levels follow it tightly
+//   pixel data, each texture starting on a 64-byte boundary
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// FNV-1a over a file's bytes; identifies identical images
+uint64_t hashContent(const unsigned char* data, size_t size);
+
+struct PackedTexture {
+    std::string path;
+    uint64_t contentHash = 0;
+    int width = 0, height = 0;
+    std::vector<const unsigned char*> levels; // RGBA8, into the mapping
+
+    int levelWidth(int level) const { return width >> level > 0 ? width >> level : 1; }
+    int levelHeight(int level) const { return height >> level > 0 ? height >> level : 1; }
+    size_t bytes() const;
+};
+
+class AssetPack {
+public:
+    AssetPack() = default;
+    AssetPack(const AssetPack&) = delete;
+    AssetPack& operator=(const AssetPack&) = delete;
+    ~AssetPack() { close(); }
+
+    // Map the pack read-only and check its index; prints an error and
+    // returns false if it is missing or malformed
+    bool open(const std::string& path);
+    void close();
+
+    // nullptr if the pack has no texture for this path
+    const PackedTexture* find(const std::string& path) const;
+    size_t size() const { return textures_.size(); }
+
+private:
+    void* mapping_ = nullptr;
+    size_t mappedBytes_ = 0;
+    std::vector<PackedTexture> textures_;
+};
+
+// Source image for the baker: decoded RGBA8, bottom row first
+struct PackImage {
+    std::string path;
+    uint64_t contentHash = 0;
+    int width = 0, height = 0;
+    std::vector<unsigned char> rgba;
+};
+
+// Build each image's mip chain and write the pack
+bool writeAssetPack(const std::string& path, const std::vector<PackImage>& images);
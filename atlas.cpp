@@ -0,0 +1,167 @@
+#include "atlas.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+const AtlasRegion* SpriteAtlas::find(const std::string& name) const {
+    for (const AtlasRegion& region : regions) {
+        if (region.name == name)
+            return &region;
+    }
+    return nullptr;
+}
+
+namespace {
+
+// One horizontal segment of the packed area's top edge
+struct SkylineNode {
+    int x, y, width;
+};
+
+// Lowest y at which a width-wide rectangle can sit starting at node i, or -1
+int fitAt(const std::vector<SkylineNode>& skyline, size_t i, int width, int atlasWidth) {
+    int x = skyline[i].x;
+    if (x + width > atlasWidth)
+        return -1;
+    int y = 0;
+    int remaining = width;
+    for (size_t j = i; remaining > 0; j++) {
+        if (j == skyline.size())
+            return -1;
+        y = std::max(y, skyline[j].y);
+        remaining -= skyline[j].width;
+    }
+    return y;
+}
+
+}
+
+bool packSkyline(int width, int height, int padding, std::vector<AtlasRegion>& regions) {
+    // Tallest first keeps the skyline flat
+    std::vector<size_t> order(regions.size());
+    for (size_t i = 0; i < order.size(); i++)
+        order[i] = i;
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        if (regions[a].height != regions[b].height)
+            return regions[a].height > regions[b].height;
+        return regions[a].width > regions[b].width;
+    });
+
+    std::vector<SkylineNode> skyline = { { 0, 0, width } };
+    for (size_t r : order) {
+        AtlasRegion& region = regions[r];
+        int w = region.width + 2 * padding;
+        int h = region.height + 2 * padding;
+
+        // Bottom-left rule: lowest resulting top edge, then narrowest node
+        int bestNode = -1, bestY = 0, bestTop = height + 1, bestWidth = 0;
+        for (size_t i = 0; i < skyline.size(); i++) {
+            int y = fitAt(skyline, i, w, width);
+            if (y < 0 || y + h > height)
+                continue;
+            if (y + h < bestTop || (y + h == bestTop && skyline[i].width < bestWidth)) {
+                bestNode = (int)i;
+                bestY = y;
+                bestTop = y + h;
+                bestWidth = skyline[i].width;
+            }
+        }
+        if (bestNode < 0)
+            return false;
+
+        int x = skyline[bestNode].x;
+        region.x = x + padding;
+        region.y = bestY + padding;
+
+        // Raise the skyline under the new rectangle, trimming the nodes it covers
+        skyline.insert(skyline.begin() + bestNode, { x, bestY + h, w });
+        for (size_t i = bestNode + 1; i < skyline.size();) {
+            int overlap = x + w - skyline[i].x;
+            if (overlap <= 0)
+                break;
+            if (overlap < skyline[i].width) {
+                skyline[i].x += overlap;
+                skyline[i].width -= overlap;
+                break;
+            }
+            skyline.erase(skyline.begin() + i);
+        }
+        // Merge neighbours at the same height
+        for (size_t i = 0; i + 1 < skyline.size();) {
+            if (skyline[i].y == skyline[i + 1].y) {
+                skyline[i].width += skyline[i + 1].width;
+                skyline.erase(skyline.begin() + i + 1);
+            } else {
+                i++;
+            }
+        }
+    }
+    return true;
+}
+
+void computeAtlasUvs(SpriteAtlas& atlas) {
+    for (AtlasRegion& region : atlas.regions) {
+        region.u0 = (float)region.x / atlas.width;
+        region.u1 = (float)(region.x + region.width) / atlas.width;
+        // Flip to a bottom-left origin
+        region.v0 = 1.0f - (float)(region.y + region.height) / atlas.height;
+        region.v1 = 1.0f - (float)region.y / atlas.height;
+    }
+}
+
+bool saveAtlas(const std::string& path, const SpriteAtlas& atlas) {
+    std::ofstream file(path);
+    file << "atlas " << atlas.width << " " << atlas.height << " " << atlas.padding << "\n";
+    for (const AtlasRegion& region : atlas.regions) {
+        file << "sprite " << region.name << " " << region.x << " " << region.y << " "
+             << region.width << " " << region.height << " "
+             << region.u0 << " " << region.v0 << " " << region.u1 << " " << region.v1 << "\n";
+    }
+    if (!file) {
+        std::cerr << "Failed to write atlas table: " << path << "\n";
+        return false;
+    }
+    return true;
+}
+
+bool loadAtlas(const std::string& path, SpriteAtlas& atlas) {
+    std::ifstream file(path);
+    if (!file) {
+        std::cerr << "Failed to open atlas table: " << path << "\n";
+        return false;
+    }
+
+    atlas = SpriteAtlas();
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line)) {
+        lineNumber++;
+        std::istringstream in(line);
+        std::string kind;
+        if (!(in >> kind))
+            continue;
+        bool ok = true;
+        if (kind == "atlas") {
+            ok = (bool)(in >> atlas.width >> atlas.height >> atlas.padding) && atlas.width > 0 && atlas.height > 0;
+        } else if (kind == "sprite") {
+            AtlasRegion region;
+            ok = (bool)(in >> region.name >> region.x >> region.y >> region.width >> region.height
+                           >> region.u0 >> region.v0 >> region.u1 >> region.v1);
+            if (ok)
+                atlas.regions.push_back(region);
+        } else {
+            ok = false;
+        }
+        if (!ok) {
+            std::cerr << path << ":" << lineNumber << ": bad atlas entry\n";
+            return false;
+        }
+    }
+    if (atlas.width == 0) {
+        std::cerr << path << ": missing atlas line\n";
+        return false;
+    }
+    return true;
+}
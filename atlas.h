@@ -0,0 +1,42 @@
+#pragma once
+
+// Texture atlas layout: where each source image sits inside one packed
+// texture, and the skyline packer that produces it.
+//
+// atlas_bake.cpp packs textures/*.png offline and writes the pixels as
+// textures/atlas/atlas.tga and the layout as textures/atlas/atlas.txt:
+//   atlas <width> <height> <padding>
+//   sprite <name> <x> <y> <w> <h> <u0> <v0> <u1> <v1>
+// x/y/w/h is the pixel rectangle with the origin at the top left. The UVs
+// follow GL's bottom-left convention, matching images loaded with
+// stbi_set_flip_vertically_on_load(true).
+
+#include <string>
+#include <vector>
+
+struct AtlasRegion {
+    std::string name;
+    int x = 0, y = 0, width = 0, height = 0;
+    float u0 = 0.0f, v0 = 0.0f, u1 = 1.0f, v1 = 1.0f;
+};
+
+struct SpriteAtlas {
+    int width = 0;
+    int height = 0;
+    int padding = 0;
+    std::vector<AtlasRegion> regions;
+
+    // nullptr if there is no region with this name
+    const AtlasRegion* find(const std::string& name) const;
+};
+
+// Place rectangles of the given sizes inside width x height, leaving padding
+// pixels free around each one. Fills x/y for every region and returns false
+// if they do not all fit.
+bool packSkyline(int width, int height, int padding, std::vector<AtlasRegion>& regions);
+
+// Compute each region's UVs from its pixel rectangle
+void computeAtlasUvs(SpriteAtlas& atlas);
+
+bool saveAtlas(const std::string& path, const SpriteAtlas& atlas);
+bool loadAtlas(const std::string& path, SpriteAtlas& atlas);
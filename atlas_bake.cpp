@@ -0,0 +1,207 @@
+// Offline texture atlas baker.
+//
+// Packs every PNG in a directory (textures/ by default) into one RGBA atlas
+// with a skyline packer and writes atlas.tga plus the atlas.txt layout table
+// (see atlas.h) into the output directory. Each image is surrounded by
+// padding filled with copies of its edge pixels, so linear filtering and
+// the first few mip levels do not pick up neighbouring sprites.
+//
+// Build: g++ -O2 atlas_bake.cpp atlas.cpp -I. -o atlas_bake
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "atlas.h"
+
+namespace fs = std::filesystem;
+
+const int DEFAULT_PADDING = 16;
+const int MAX_ATLAS_SIZE = 8192;
+
+struct SourceImage {
+    int width = 0, height = 0;
+    unsigned char* pixels = nullptr; // RGBA, top row first
+};
+
+// Uncompressed TGA is what stb_image can read back without a PNG encoder;
+// run-length encoding keeps the transparent padding and gaps small.
+bool writeTga(const std::string& path, int width, int height, const std::vector<unsigned char>& rgba) {
+    std::vector<unsigned char> data(18, 0);
+    data[2] = 10; // run-length encoded true colour
+    data[12] = (unsigned char)width;
+    data[13] = (unsigned char)(width >> 8);
+    data[14] = (unsigned char)height;
+    data[15] = (unsigned char)(height >> 8);
+    data[16] = 32;
+    data[17] = 0x28; // 8 alpha bits, top-left origin
+
+    auto pixel = [&](int x, int y) {
+        uint32_t p;
+        memcpy(&p, &rgba[((size_t)y * width + x) * 4], 4);
+        return p;
+    };
+    auto putPixel = [&](uint32_t p) {
+        unsigned char c[4];
+        memcpy(c, &p, 4);
+        // TGA stores BGRA
+        data.push_back(c[2]);
+        data.push_back(c[1]);
+        data.push_back(c[0]);
+        data.push_back(c[3]);
+    };
+
+    // Packets never cross a row
+    for (int y = 0; y < height; y++) {
+        int x = 0;
+        while (x < width) {
+            int run = 1;
+            while (x + run < width && run < 128 && pixel(x + run, y) == pixel(x, y))
+                run++;
+            if (run > 1) {
+                data.push_back((unsigned char)(0x80 | (run - 1)));
+                putPixel(pixel(x, y));
+                x += run;
+                continue;
+            }
+            // Literal packet up to the next run of two or more
+            int count = 1;
+            while (x + count < width && count < 128 &&
+                   !(x + count + 1 < width && pixel(x + count, y) == pixel(x + count + 1, y)))
+                count++;
+            data.push_back((unsigned char)(count - 1));
+            for (int i = 0; i < count; i++)
+                putPixel(pixel(x + i, y));
+            x += count;
+        }
+    }
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file.write((const char*)data.data(), data.size())) {
+        std::cerr << "Failed to write atlas image: " << path << "\n";
+        return false;
+    }
+    return true;
+}
+
+// Copy an image into the atlas and extend its edge pixels into the padding
+void blitPadded(std::vector<unsigned char>& atlas, int atlasWidth, const AtlasRegion& region,
+                const SourceImage& image, int padding) {
+    for (int y = -padding; y < region.height + padding; y++) {
+        int sy = std::min(std::max(y, 0), image.height - 1);
+        for (int x = -padding; x < region.width + padding; x++) {
+            int sx = std::min(std::max(x, 0), image.width - 1);
+            memcpy(&atlas[((size_t)(region.y + y) * atlasWidth + region.x + x) * 4],
+                   &image.pixels[((size_t)sy * image.width + sx) * 4], 4);
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    std::string inputDir = "textures";
+    std::string outputDir = "textures/atlas";
+    int padding = DEFAULT_PADDING;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--padding") == 0 && i + 1 < argc) {
+            padding = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--input") == 0 && i + 1 < argc) {
+            inputDir = argv[++i];
+        } else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+            outputDir = argv[++i];
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--input DIR] [--output DIR] [--padding N]\n";
+            return -1;
+        }
+    }
+    if (padding < 0) {
+        std::cerr << "--padding must not be negative\n";
+        return -1;
+    }
+
+    // Sorted so the layout does not depend on directory order
+    std::vector<fs::path> paths;
+    std::error_code error;
+    for (const fs::directory_entry& entry : fs::directory_iterator(inputDir, error)) {
+        if (entry.is_regular_file() && entry.path().extension() == ".png")
+            paths.push_back(entry.path());
+    }
+    if (error) {
+        std::cerr << "Failed to list " << inputDir << ": " << error.message() << "\n";
+        return -1;
+    }
+    std::sort(paths.begin(), paths.end());
+    if (paths.empty()) {
+        std::cerr << "No PNG files in " << inputDir << "\n";
+        return -1;
+    }
+
+    SpriteAtlas atlas;
+    atlas.padding = padding;
+    std::vector<SourceImage> images;
+    long long area = 0;
+    for (const fs::path& path : paths) {
+        SourceImage image;
+        int channels;
+        image.pixels = stbi_load(path.string().c_str(), &image.width, &image.height, &channels, 4);
+        if (!image.pixels) {
+            std::cerr << "Failed to load " << path.string() << ": " << stbi_failure_reason() << "\n";
+            return -1;
+        }
+        AtlasRegion region;
+        region.name = path.stem().string();
+        region.width = image.width;
+        region.height = image.height;
+        atlas.regions.push_back(region);
+        images.push_back(image);
+        area += (long long)(image.width + 2 * padding) * (image.height + 2 * padding);
+    }
+
+    // Smallest power-of-two square that could hold everything, then grow
+    // width and height in turn until the packer succeeds
+    int width = 64, height = 64;
+    while ((long long)width * height < area) {
+        if (width <= height)
+            width *= 2;
+        else
+            height *= 2;
+    }
+    while (!packSkyline(width, height, padding, atlas.regions)) {
+        if (width <= height)
+            width *= 2;
+        else
+            height *= 2;
+        if (width > MAX_ATLAS_SIZE || height > MAX_ATLAS_SIZE) {
+            std::cerr << "Images do not fit in a " << MAX_ATLAS_SIZE << "x" << MAX_ATLAS_SIZE << " atlas\n";
+            return -1;
+        }
+    }
+    atlas.width = width;
+    atlas.height = height;
+    computeAtlasUvs(atlas);
+
+    std::vector<unsigned char> pixels((size_t)width * height * 4, 0);
+    for (size_t i = 0; i < images.size(); i++) {
+        blitPadded(pixels, width, atlas.regions[i], images[i], padding);
+        stbi_image_free(images[i].pixels);
+    }
+
+    fs::create_directories(outputDir, error);
+    if (!writeTga(outputDir + "/atlas.tga", width, height, pixels) ||
+        !saveAtlas(outputDir + "/atlas.txt", atlas))
+        return -1;
+
+    long long used = 0;
+    for (const AtlasRegion& region : atlas.regions)
+        used += (long long)region.width * region.height;
+    std::cout << "Packed " << atlas.regions.size() << " images into " << width << "x" << height
+              << " (" << 100.0 * used / ((double)width * height) << "% used, padding " << padding << ")\n";
+    return 0;
+}
@@ -1,11 +1,23 @@
 #version 330 core
+// Variants (defined by the shader library):
+//   TEXTURE_ARRAY  sample layer Layer of a 2D array texture
 out vec4 FragColor;
 
 in vec2 TexCoord;
 
+#ifdef TEXTURE_ARRAY
+flat in float Layer;
+uniform sampler2DArray texture1;
+#else
 uniform sampler2D texture1;
+#endif
 
 void main()
 {
-    FragColor = texture(texture1, TexCoord);
+#ifdef TEXTURE_ARRAY
+    vec4 color = texture(texture1, vec3(TexCoord, Layer));
+#else
+    vec4 color = texture(texture1, TexCoord);
+#endif
+    FragColor = color;
 }
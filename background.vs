@@ -1,13 +1,52 @@
 #version 330 core
+// Variants (defined by the shader library):
+//   INSTANCED  position, scale and UV rectangle come per instance
+//   ATLAS      texture coordinates are remapped into an atlas region
+//   VERTEX_ID  (with INSTANCED) the unit quad comes from gl_VertexID, drawn
+//              as a 4-vertex triangle strip with no vertex or index buffer
+//   TEXTURE_ARRAY  (with INSTANCED) pass the instance's layer to the
+//              fragment shader to pick a texture array layer
+#ifndef VERTEX_ID
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec2 aTexCoord;
+#endif
 
+#ifdef INSTANCED
+layout (location = 2) in vec2 aOffset;
+layout (location = 3) in float aScale;
+layout (location = 4) in float aLayer;
+layout (location = 5) in vec4 aUvRect;
+#else
 uniform vec2 offset;
+uniform vec4 uvRect;
+#endif
 
 out vec2 TexCoord;
+#ifdef TEXTURE_ARRAY
+flat out float Layer;
+#endif
 
 void main()
 {
+#ifdef VERTEX_ID
+    // Strip order: (0,0) (1,0) (0,1) (1,1)
+    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+    vec3 aPos = vec3(corner * 2.0 - 1.0, 0.0);
+    vec2 aTexCoord = corner;
+#endif
+#ifdef INSTANCED
+    gl_Position = vec4(aPos.xy * aScale + aOffset, aPos.z, 1.0);
+    vec4 rect = aUvRect;
+#else
     gl_Position = vec4(aPos.x + offset.x, aPos.y + offset.y, aPos.z, 1.0);
+    vec4 rect = uvRect;
+#endif
+#ifdef TEXTURE_ARRAY
+    Layer = aLayer;
+#endif
+#ifdef ATLAS
+    TexCoord = mix(rect.xy, rect.zw, aTexCoord);
+#else
     TexCoord = aTexCoord;
+#endif
 }
@@ -0,0 +1,147 @@
+#include "bench.h"
+
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <string>
+
+#include "collide_simd.h"
+#include "entities.h"
+#include "rng.h"
+#include "sim.h"
+#include "spatial_grid.h"
+
+namespace {
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// The pre-grid narrow phase: test every enemy, keep the first hit
+int bruteFirstOverlap(const EntityStore& e, int first, int count, float px, float py, float half) {
+    for (int n = first; n < first + count; n++) {
+        if (e.alive[n] && std::abs(px - e.x[n]) < half && std::abs(py - e.y[n]) < half)
+            return n;
+    }
+    return -1;
+}
+
+// count enemies followed by count projectiles, uniformly spread over a square
+// sized for about one enemy per collision cell. Packing 100k enemies into
+// the +-1 screen would make nearly every query hit at once and hide the
+// cost of a miss, which is what brute force pays for.
+void scatter(EntityStore& e, int count, uint64_t seed) {
+    e.resize(2 * count);
+    const float halfSize = 0.5f * COLLISION_CELL_SIZE * std::sqrt((float)count);
+    for (int n = 0; n < 2 * count; n++) {
+        RandomDraw r = randomDraw(seed, n, 0);
+        e.x[n] = (r.v[0] * (1.0f / 4294967296.0f) * 2.0f - 1.0f) * halfSize;
+        e.y[n] = (r.v[1] * (1.0f / 4294967296.0f) * 2.0f - 1.0f) * halfSize;
+        e.type[n] = n < count ? ENTITY_ENEMY : ENTITY_ENEMY_PROJECTILE;
+        e.alive[n] = 1;
+    }
+}
+
+// Narrow-phase kernels on their own: one point against a long contiguous run
+// of positions, the inner loop of a bullet-heavy tick
+bool benchmarkKernels(const EntityStore& e, int count) {
+    const char* names[] = { "scalar", "sse2", "avx2" };
+    const int queries = 200;
+    const int blocks = count / OVERLAP_BLOCK;
+    long reference = -1;
+    bool agree = true;
+
+    std::cout << "  narrow phase, " << queries << " points x " << blocks * OVERLAP_BLOCK << " enemies:";
+    for (const char* name : names) {
+        OverlapKernel kernel = overlapKernelByName(name);
+        if (!kernel) {
+            std::cout << " " << name << " n/a";
+            continue;
+        }
+        long hits = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int q = 0; q < queries; q++) {
+            float px = e.x[count + q], py = e.y[count + q];
+            for (int b = 0; b < blocks; b++)
+                hits += __builtin_popcount(kernel(e.x + b * OVERLAP_BLOCK, e.y + b * OVERLAP_BLOCK, OVERLAP_BLOCK, px, py, 0.1f));
+        }
+        double seconds = secondsSince(start);
+        std::cout << " " << name << " " << seconds * 1e9 / ((double)queries * blocks) << " ns/block";
+        if (reference < 0)
+            reference = hits;
+        agree &= hits == reference;
+    }
+    std::cout << " (" << OVERLAP_BLOCK << " tests per block, using " << overlapKernelName() << ")\n";
+    return agree;
+}
+
+}
+
+int runCollisionBenchmark(uint64_t seed) {
+    const int counts[] = { 10000, 100000 };
+    // Brute force over every projectile is quadratic, so it is timed on a
+    // prefix of the queries and scaled up
+    const int bruteQueryLimit = 2000;
+
+    for (int count : counts) {
+        EntityStore e;
+        scatter(e, count, seed);
+        const int firstEnemy = 0;
+        const int firstProjectile = count;
+        SpatialHashGrid enemyGrid(COLLISION_CELL_SIZE);
+
+        // Case 1: the game's own load, a handful of queries per tick
+        const float points[4][2] = { { 0.0f, 0.0f }, { 0.5f, 0.5f }, { -3.0f, 2.0f }, { 7.0f, -7.0f } };
+        const int rounds = 100;
+        long bruteHits = 0, gridHits = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int r = 0; r < rounds; r++) {
+            for (const auto& p : points)
+                bruteHits += bruteFirstOverlap(e, firstEnemy, count, p[0], p[1], 0.1f) >= 0;
+        }
+        double bruteGame = secondsSince(start) / rounds;
+
+        start = std::chrono::steady_clock::now();
+        for (int r = 0; r < rounds; r++) {
+            enemyGrid.build(e.x, e.y, e.alive, firstEnemy, count);
+            for (const auto& p : points)
+                gridHits += enemyGrid.firstOverlap(p[0], p[1], 0.1f) >= 0;
+        }
+        double gridGame = secondsSince(start) / rounds;
+
+        // Case 2: every projectile against every enemy, the shape of a
+        // bullet-heavy mode
+        const int bruteQueries = count < bruteQueryLimit ? count : bruteQueryLimit;
+        long bruteBulletHits = 0;
+        start = std::chrono::steady_clock::now();
+        for (int n = firstProjectile; n < firstProjectile + bruteQueries; n++)
+            bruteBulletHits += bruteFirstOverlap(e, firstEnemy, count, e.x[n], e.y[n], 0.1f) >= 0;
+        double bruteBullets = secondsSince(start) * count / bruteQueries;
+
+        long gridBulletHits = 0, gridBulletHitsPrefix = 0;
+        start = std::chrono::steady_clock::now();
+        enemyGrid.build(e.x, e.y, e.alive, firstEnemy, count);
+        for (int n = firstProjectile; n < firstProjectile + count; n++) {
+            bool hit = enemyGrid.firstOverlap(e.x[n], e.y[n], 0.1f) >= 0;
+            gridBulletHits += hit;
+            if (n < firstProjectile + bruteQueries)
+                gridBulletHitsPrefix += hit;
+        }
+        double gridBullets = secondsSince(start);
+
+        bool agree = bruteHits == gridHits && bruteBulletHits == gridBulletHitsPrefix;
+        std::cout << "Collision: " << count << " enemies, " << count << " projectiles\n"
+                  << "  4 queries:        brute " << bruteGame * 1000.0 << " ms, grid incl. build "
+                  << gridGame * 1000.0 << " ms\n"
+                  << "  every projectile: brute " << bruteBullets * 1000.0 << " ms"
+                  << (bruteQueries < count ? " (scaled from " + std::to_string(bruteQueries) + " queries)" : "")
+                  << ", grid incl. build " << gridBullets * 1000.0 << " ms (" << gridBulletHits << " hits)\n"
+                  << "  results " << (agree ? "match" : "DIFFER") << "\n";
+        bool kernelsAgree = benchmarkKernels(e, count);
+        if (!kernelsAgree)
+            std::cout << "  kernel results DIFFER\n";
+        if (!agree || !kernelsAgree)
+            return 1;
+    }
+    return 0;
+}
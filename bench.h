@@ -0,0 +1,8 @@
+#pragma once
+
+// Offline micro-benchmarks, run from the command line instead of the game.
+
+#include <cstdint>
+
+// Spatial hash grid against the old brute-force loops at 10k and 100k enemies
+int runCollisionBenchmark(uint64_t seed);
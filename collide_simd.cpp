@@ -0,0 +1,108 @@
+#include "collide_simd.h"
+
+#include <cmath>
+#include <cstring>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define MYSTIC_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+namespace {
+
+uint32_t overlapScalar(const float* x, const float* y, int count, float px, float py, float half) {
+    uint32_t mask = 0;
+    for (int i = 0; i < count; i++) {
+        if (std::abs(px - x[i]) < half && std::abs(py - y[i]) < half)
+            mask |= 1u << i;
+    }
+    return mask;
+}
+
+#ifdef MYSTIC_X86_SIMD
+
+__attribute__((target("sse2")))
+uint32_t overlapSse2(const float* x, const float* y, int count, float px, float py, float half) {
+    const __m128 signBit = _mm_set1_ps(-0.0f);
+    const __m128 vx = _mm_set1_ps(px), vy = _mm_set1_ps(py), vh = _mm_set1_ps(half);
+    uint32_t mask = 0;
+    for (int i = 0; i < OVERLAP_BLOCK; i += 4) {
+        __m128 dx = _mm_andnot_ps(signBit, _mm_sub_ps(vx, _mm_loadu_ps(x + i)));
+        __m128 dy = _mm_andnot_ps(signBit, _mm_sub_ps(vy, _mm_loadu_ps(y + i)));
+        __m128 hit = _mm_and_ps(_mm_cmplt_ps(dx, vh), _mm_cmplt_ps(dy, vh));
+        mask |= (uint32_t)_mm_movemask_ps(hit) << i;
+    }
+    return count < OVERLAP_BLOCK ? mask & ((1u << count) - 1) : mask;
+}
+
+__attribute__((target("avx2")))
+uint32_t overlapAvx2(const float* x, const float* y, int count, float px, float py, float half) {
+    const __m256 signBit = _mm256_set1_ps(-0.0f);
+    const __m256 vx = _mm256_set1_ps(px), vy = _mm256_set1_ps(py), vh = _mm256_set1_ps(half);
+    uint32_t mask = 0;
+    for (int i = 0; i < OVERLAP_BLOCK; i += 8) {
+        __m256 dx = _mm256_andnot_ps(signBit, _mm256_sub_ps(vx, _mm256_loadu_ps(x + i)));
+        __m256 dy = _mm256_andnot_ps(signBit, _mm256_sub_ps(vy, _mm256_loadu_ps(y + i)));
+        __m256 hit = _mm256_and_ps(_mm256_cmp_ps(dx, vh, _CMP_LT_OQ), _mm256_cmp_ps(dy, vh, _CMP_LT_OQ));
+        mask |= (uint32_t)_mm256_movemask_ps(hit) << i;
+    }
+    return count < OVERLAP_BLOCK ? mask & ((1u << count) - 1) : mask;
+}
+
+#endif
+
+struct KernelEntry {
+    const char* name;
+    OverlapKernel kernel;
+};
+
+KernelEntry bestKernel() {
+#ifdef MYSTIC_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return { "avx2", overlapAvx2 };
+    if (__builtin_cpu_supports("sse2"))
+        return { "sse2", overlapSse2 };
+#endif
+    return { "scalar", overlapScalar };
+}
+
+KernelEntry& current() {
+    static KernelEntry entry = bestKernel();
+    return entry;
+}
+
+}
+
+OverlapKernel overlapKernel() {
+    return current().kernel;
+}
+
+const char* overlapKernelName() {
+    return current().name;
+}
+
+OverlapKernel overlapKernelByName(const char* name) {
+    if (strcmp(name, "scalar") == 0)
+        return overlapScalar;
+#ifdef MYSTIC_X86_SIMD
+    __builtin_cpu_init();
+    if (strcmp(name, "sse2") == 0 && __builtin_cpu_supports("sse2"))
+        return overlapSse2;
+    if (strcmp(name, "avx2") == 0 && __builtin_cpu_supports("avx2"))
+        return overlapAvx2;
+#endif
+    return nullptr;
+}
+
+bool setOverlapKernel(const char* name) {
+    OverlapKernel kernel = overlapKernelByName(name);
+    if (!kernel)
+        return false;
+    static const char* const names[] = { "scalar", "sse2", "avx2" };
+    for (const char* known : names) {
+        if (strcmp(known, name) == 0)
+            current() = { known, kernel };
+    }
+    return true;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+// Narrow-phase hit test of one point against a run of positions.
+//
+// The kernels test up to 16 entities per call and return a bitmask with bit
+// i set when |px - x[i]| < half && |py - y[i]| < half, the exact test the
+// game has always used. AVX2 and SSE2 versions are picked at runtime from
+// what the CPU supports, with a scalar fallback everywhere else.
+
+#include <cstdint>
+
+// Elements a kernel tests per call
+const int OVERLAP_BLOCK = 16;
+
+// Tests count <= OVERLAP_BLOCK elements. x and y must stay readable for a
+// full OVERLAP_BLOCK elements; bits past count are always clear.
+typedef uint32_t (*OverlapKernel)(const float* x, const float* y, int count, float px, float py, float half);
+
+// Best kernel for this CPU, chosen on first use
+OverlapKernel overlapKernel();
+const char* overlapKernelName();
+
+// A specific kernel, or nullptr if the name is unknown or the CPU lacks it.
+// Names are "scalar", "sse2" and "avx2".
+OverlapKernel overlapKernelByName(const char* name);
+
+// Use a specific kernel from now on; returns false if it is unavailable
+bool setOverlapKernel(const char* name);
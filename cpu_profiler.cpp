@@ -0,0 +1,153 @@
+#include "cpu_profiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define MYSTIC_PROFILE_TSC 1
+#include <x86intrin.h>
+#endif
+
+namespace {
+
+struct ZoneEvent {
+    const char* name;
+    uint64_t start;
+    uint64_t end;
+};
+
+// One per thread that has recorded a zone, never freed: the exporter may
+// read it after the thread exits. Only the owning thread writes events and
+// head; it publishes each event by bumping head.
+struct ThreadBuffer {
+    ZoneEvent events[CPU_PROFILER_EVENTS];
+    std::atomic<uint64_t> head{ 0 };
+    std::atomic<const char*> name{ nullptr };
+    uint32_t id = 0;
+    ThreadBuffer* next = nullptr;
+};
+
+// Lock-free list of every thread's buffer, newest first
+std::atomic<ThreadBuffer*> threadBuffers{ nullptr };
+std::atomic<uint32_t> nextThreadId{ 1 };
+
+thread_local ThreadBuffer* localBuffer = nullptr;
+
+ThreadBuffer* registerThread() {
+    ThreadBuffer* buffer = new ThreadBuffer();
+    buffer->id = nextThreadId.fetch_add(1);
+    buffer->next = threadBuffers.load(std::memory_order_relaxed);
+    while (!threadBuffers.compare_exchange_weak(buffer->next, buffer, std::memory_order_release,
+                                                std::memory_order_relaxed)) {}
+    localBuffer = buffer;
+    return buffer;
+}
+
+// Converts raw timestamps to microseconds from the first call. For the TSC
+// the rate comes from steady_clock over the whole run, so the longer the
+// run the better the estimate.
+struct Clock {
+    uint64_t origin;
+    std::chrono::steady_clock::time_point originTime;
+};
+
+const Clock& clockOrigin() {
+    static const Clock origin = { profilerTimestamp(), std::chrono::steady_clock::now() };
+    return origin;
+}
+
+// Start the clock before main, so zones from the first frame convert
+const Clock& startClock = clockOrigin();
+
+double ticksPerMicrosecond() {
+#ifdef MYSTIC_PROFILE_TSC
+    const Clock& origin = clockOrigin();
+    double elapsed = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - origin.originTime).count();
+    uint64_t ticks = profilerTimestamp() - origin.origin;
+    return elapsed > 0.0 && ticks ? ticks / elapsed : 1.0;
+#else
+    return 1000.0;
+#endif
+}
+
+}
+
+uint64_t profilerTimestamp() {
+#ifdef MYSTIC_PROFILE_TSC
+    return __rdtsc();
+#else
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+void recordZone(const char* name, uint64_t start, uint64_t end) {
+    ThreadBuffer* buffer = localBuffer;
+    if (!buffer)
+        buffer = registerThread();
+    uint64_t head = buffer->head.load(std::memory_order_relaxed);
+    buffer->events[head & (CPU_PROFILER_EVENTS - 1)] = { name, start, end };
+    buffer->head.store(head + 1, std::memory_order_release);
+}
+
+void setProfilerThreadName(const char* name) {
+    ThreadBuffer* buffer = localBuffer;
+    if (!buffer)
+        buffer = registerThread();
+    buffer->name.store(name, std::memory_order_relaxed);
+}
+
+bool writeChromeTrace(const std::string& path) {
+    const double ticksPerUs = ticksPerMicrosecond();
+    const uint64_t origin = clockOrigin().origin;
+
+    std::ofstream file(path);
+    file.precision(3);
+    file << std::fixed << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+    bool first = true;
+    size_t zones = 0;
+    std::vector<ZoneEvent> events;
+    for (ThreadBuffer* buffer = threadBuffers.load(std::memory_order_acquire); buffer; buffer = buffer->next) {
+        const char* name = buffer->name.load(std::memory_order_relaxed);
+        if (name) {
+            file << (first ? "\n" : ",\n") << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": "
+                 << buffer->id << ", \"args\": {\"name\": \"" << name << "\"}}";
+            first = false;
+        }
+
+        // Copy the newest events, then drop any the owner may have
+        // overwritten while we copied
+        uint64_t head = buffer->head.load(std::memory_order_acquire);
+        uint64_t begin = head > CPU_PROFILER_EVENTS ? head - CPU_PROFILER_EVENTS : 0;
+        events.clear();
+        for (uint64_t i = begin; i < head; i++)
+            events.push_back(buffer->events[i & (CPU_PROFILER_EVENTS - 1)]);
+        uint64_t after = buffer->head.load(std::memory_order_acquire);
+        // The owner may already be writing event after, which shares a slot
+        // with event after - CPU_PROFILER_EVENTS, so that one is suspect too
+        uint64_t overwritten = after >= CPU_PROFILER_EVENTS ? after + 1 - CPU_PROFILER_EVENTS : 0;
+        size_t skip = overwritten > begin ? (size_t)std::min<uint64_t>(overwritten - begin, events.size()) : 0;
+
+        for (size_t i = skip; i < events.size(); i++) {
+            const ZoneEvent& e = events[i];
+            if (e.start < origin)
+                continue;
+            file << (first ? "\n" : ",\n") << "{\"name\": \"" << e.name << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": "
+                 << buffer->id << ", \"ts\": " << (e.start - origin) / ticksPerUs
+                 << ", \"dur\": " << (e.end - e.start) / ticksPerUs << "}";
+            first = false;
+            zones++;
+        }
+    }
+    file << "\n]}\n";
+    if (!file) {
+        std::cerr << "Failed to write CPU trace: " << path << "\n";
+        return false;
+    }
+    std::cout << "CPU trace: " << zones << " zones written to " << path << "\n";
+    return true;
+}
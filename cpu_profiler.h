@@ -0,0 +1,67 @@
+#pragma once
+
+// Scoped CPU timing zones, exported as a Chrome trace.
+//
+// PROFILE_ZONE("name") times the rest of the enclosing scope;
+// PROFILE_BEGIN(tag) ... PROFILE_END(tag, "name") times a stretch that is
+// not a scope of its own. Each thread records into its own ring buffer of
+// CPU_PROFILER_EVENTS zones, so recording takes no lock and only the newest
+// zones are kept. writeChromeTrace() can run on any thread at any time;
+// zones overwritten while it copies are skipped. Open the file in
+// chrome://tracing or Perfetto.
+//
+// Zones compile to nothing unless the build defines MYSTIC_PROFILE. When
+// enabled a zone costs two timestamp reads and one 24-byte store, and the
+// reads dominate: a zone takes about 45 ns where rdtsc takes 20 ns, as in
+// some VMs, so keep zones off anything run per entity. Zone names must be
+// string literals (or otherwise outlive the export).
+
+#include <cstdint>
+#include <string>
+
+#ifdef MYSTIC_PROFILE
+const bool CPU_PROFILER_ENABLED = true;
+#else
+const bool CPU_PROFILER_ENABLED = false;
+#endif
+
+// Zones kept per thread; a power of two
+const uint32_t CPU_PROFILER_EVENTS = 1u << 16;
+
+// Raw timestamp: the TSC on x86, steady_clock nanoseconds elsewhere
+uint64_t profilerTimestamp();
+
+void recordZone(const char* name, uint64_t start, uint64_t end);
+// Label the calling thread in the trace
+void setProfilerThreadName(const char* name);
+
+// Every zone still in the ring buffers, as trace_event JSON. Returns false
+// if the file cannot be written.
+bool writeChromeTrace(const std::string& path);
+
+class CpuZone {
+public:
+    explicit CpuZone(const char* name) : name_(name), start_(profilerTimestamp()) {}
+    ~CpuZone() { recordZone(name_, start_, profilerTimestamp()); }
+    CpuZone(const CpuZone&) = delete;
+    CpuZone& operator=(const CpuZone&) = delete;
+
+private:
+    const char* name_;
+    uint64_t start_;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+
+#ifdef MYSTIC_PROFILE
+#define PROFILE_ZONE(name) CpuZone PROFILE_CONCAT(profileZone, __LINE__)(name)
+#define PROFILE_BEGIN(tag) const uint64_t PROFILE_CONCAT(tag, ProfileStart) = profilerTimestamp()
+#define PROFILE_END(tag, name) recordZone(name, PROFILE_CONCAT(tag, ProfileStart), profilerTimestamp())
+#define PROFILE_THREAD(name) setProfilerThreadName(name)
+#else
+#define PROFILE_ZONE(name) ((void)0)
+#define PROFILE_BEGIN(tag) ((void)0)
+#define PROFILE_END(tag, name) ((void)0)
+#define PROFILE_THREAD(name) ((void)0)
+#endif
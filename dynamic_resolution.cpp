@@ -0,0 +1,97 @@
+#include "dynamic_resolution.h"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#include "gpu_profiler.h"
+
+namespace {
+
+// Aim this far under the budget, and only scale back up once frames come in
+// below RAISE_FRACTION of it, so measurement noise does not flip the scale
+// every frame
+const double TARGET_FRACTION = 0.9;
+const double RAISE_FRACTION = 0.75;
+
+// Largest change per adjustment
+const float MAX_STEP = 0.1f;
+
+}
+
+DynamicResolution::~DynamicResolution() {
+    if (framebuffer_)
+        glDeleteFramebuffers(1, &framebuffer_);
+    if (colorBuffer_)
+        glDeleteRenderbuffers(1, &colorBuffer_);
+}
+
+bool DynamicResolution::init(int width, int height, const DynamicResolutionOptions& options) {
+    options_ = options;
+    width_ = width;
+    height_ = height;
+    scale_ = fixed() ? std::min(options_.fixedScale, 1.0f) : options_.maxScale;
+
+    glGenRenderbuffers(1, &colorBuffer_);
+    glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer_);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width_, height_);
+    glGenFramebuffers(1, &framebuffer_);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer_);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer_);
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "Offscreen framebuffer incomplete (0x" << std::hex << status << std::dec << ")\n";
+        return false;
+    }
+    return true;
+}
+
+int DynamicResolution::scaled(int size) const {
+    return std::max(1, (int)std::lround(size * scale_));
+}
+
+void DynamicResolution::beginScene() {
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer_);
+    glViewport(0, 0, sceneWidth(), sceneHeight());
+    glScissor(0, 0, sceneWidth(), sceneHeight());
+    glEnable(GL_SCISSOR_TEST);
+}
+
+void DynamicResolution::present() {
+    glDisable(GL_SCISSOR_TEST);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer_);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+    const bool fullSize = sceneWidth() == width_ && sceneHeight() == height_;
+    glBlitFramebuffer(0, 0, sceneWidth(), sceneHeight(), 0, 0, width_, height_, GL_COLOR_BUFFER_BIT,
+                      fullSize ? GL_NEAREST : GL_LINEAR);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    scaleSum_ += scale_;
+    frames_++;
+}
+
+void DynamicResolution::reportGpuTime(double gpuMs) {
+    gpuMsSum_ += gpuMs;
+    gpuSamples_++;
+    if (fixed() || gpuMs <= 0.0)
+        return;
+    // Results lag a few frames behind; the ones still in flight after a
+    // change were rendered at the old scale
+    if (settleResults_ > 0) {
+        settleResults_--;
+        return;
+    }
+    if (gpuMs <= options_.budgetMs && gpuMs >= options_.budgetMs * RAISE_FRACTION)
+        return;
+
+    float wanted = scale_ * (float)std::sqrt(options_.budgetMs * TARGET_FRACTION / gpuMs);
+    wanted = std::min(std::max(wanted, scale_ - MAX_STEP), scale_ + MAX_STEP);
+    wanted = std::min(std::max(wanted, options_.minScale), options_.maxScale);
+    if (std::abs(wanted - scale_) < 0.01f)
+        return;
+    scale_ = wanted;
+    settleResults_ = GPU_PROFILER_FRAMES - 1;
+    changes_++;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+// Renders the scene into an offscreen framebuffer at a fraction of the
+// window resolution and upscales it to the window with a linear blit.
+//
+// The scale adapts to the GPU time of each frame, which the caller measures
+// (GpuProfiler) and passes to reportGpuTime(): over budget it drops,
+// comfortably under it rises again, within [minScale, maxScale]. Fill cost
+// goes with the pixel count, so each step moves the scale by the square
+// root of the budget ratio. The framebuffer is allocated once at full size
+// and the scene is drawn into its lower-left corner, so a scale change
+// costs nothing.
+
+#include <cstdint>
+
+struct DynamicResolutionOptions {
+    double budgetMs = 1000.0 / 60.0; // GPU time a frame may take
+    float minScale = 0.5f;
+    float maxScale = 1.0f;
+    float fixedScale = 0.0f; // > 0 pins the scale, for benchmarking
+};
+
+class DynamicResolution {
+public:
+    DynamicResolution() = default;
+    ~DynamicResolution();
+    DynamicResolution(const DynamicResolution&) = delete;
+    DynamicResolution& operator=(const DynamicResolution&) = delete;
+
+    // Needs a current GL context. width x height is the window's
+    // framebuffer. Returns false if the offscreen target cannot be created;
+    // draw straight to the window then.
+    bool init(int width, int height, const DynamicResolutionOptions& options = DynamicResolutionOptions());
+
+    // Bind the offscreen target with the viewport (and scissor, so clears
+    // stay inside it) at the current scale
+    void beginScene();
+    // Upscale to the default framebuffer
+    void present();
+    // Adapt the scale to a measured GPU frame time
+    void reportGpuTime(double gpuMs);
+
+    float scale() const { return scale_; }
+    bool fixed() const { return options_.fixedScale > 0.0f; }
+    int sceneWidth() const { return scaled(width_); }
+    int sceneHeight() const { return scaled(height_); }
+
+    // Averages since init, for the exit report
+    double averageScale() const { return frames_ ? scaleSum_ / frames_ : scale_; }
+    double averageGpuMs() const { return gpuSamples_ ? gpuMsSum_ / gpuSamples_ : 0.0; }
+    uint64_t scaleChanges() const { return changes_; }
+
+private:
+    int scaled(int size) const;
+
+    DynamicResolutionOptions options_;
+    int width_ = 0;
+    int height_ = 0;
+    unsigned int framebuffer_ = 0;
+    unsigned int colorBuffer_ = 0;
+    float scale_ = 1.0f;
+    int settleResults_ = 0; // results to ignore, still measured at the old scale
+    double scaleSum_ = 0.0;
+    double gpuMsSum_ = 0.0;
+    uint64_t gpuSamples_ = 0;
+    uint64_t frames_ = 0;
+    uint64_t changes_ = 0;
+};
@@ -0,0 +1,145 @@
+#include "entities.h"
+
+#include <cstring>
+#include <new>
+#include <utility>
+
+namespace {
+
+// Bytes per entity in each block
+const size_t HOT_STRIDE = 4 * sizeof(float) + 3 * sizeof(uint8_t);
+const size_t COLD_STRIDE = 3 * sizeof(uint64_t) + sizeof(uint32_t);
+
+unsigned char* allocateBlock(size_t bytes) {
+    unsigned char* block = static_cast<unsigned char*>(::operator new(bytes, std::align_val_t(CACHE_LINE_SIZE)));
+    memset(block, 0, bytes);
+    return block;
+}
+
+void freeBlock(unsigned char* block) {
+    if (block)
+        ::operator delete(block, std::align_val_t(CACHE_LINE_SIZE));
+}
+
+}
+
+EntityStore::EntityStore(const EntityStore& other) {
+    *this = other;
+}
+
+EntityStore& EntityStore::operator=(const EntityStore& other) {
+    if (this == &other)
+        return *this;
+    if (capacity_ != other.capacity_) {
+        release();
+        allocate(other.capacity_);
+    }
+    count_ = other.count_;
+    if (capacity_) {
+        memcpy(hot_, other.hot_, capacity_ * HOT_STRIDE);
+        memcpy(cold_, other.cold_, capacity_ * COLD_STRIDE);
+    }
+    return *this;
+}
+
+EntityStore::~EntityStore() {
+    release();
+}
+
+void EntityStore::resize(size_t count) {
+    if (count <= capacity_) {
+        // Zero anything dropped so a later grow starts clean
+        for (size_t i = count; i < count_; i++) {
+            x[i] = y[i] = vx[i] = vy[i] = 0.0f;
+            type[i] = alive[i] = teleported[i] = 0;
+            randomIndex[i] = 0;
+            randomStream[i] = 0;
+            lastDirectionChangeTick[i] = lastShotTick[i] = 0;
+        }
+        count_ = count;
+        return;
+    }
+
+    EntityStore grown;
+    grown.allocate(count);
+    grown.count_ = count;
+    size_t n = count_;
+    if (n) {
+        memcpy(grown.x, x, n * sizeof(float));
+        memcpy(grown.y, y, n * sizeof(float));
+        memcpy(grown.vx, vx, n * sizeof(float));
+        memcpy(grown.vy, vy, n * sizeof(float));
+        memcpy(grown.type, type, n);
+        memcpy(grown.alive, alive, n);
+        memcpy(grown.teleported, teleported, n);
+        memcpy(grown.randomIndex, randomIndex, n * sizeof(uint64_t));
+        memcpy(grown.randomStream, randomStream, n * sizeof(uint32_t));
+        memcpy(grown.lastDirectionChangeTick, lastDirectionChangeTick, n * sizeof(uint64_t));
+        memcpy(grown.lastShotTick, lastShotTick, n * sizeof(uint64_t));
+    }
+    swap(grown);
+}
+
+void EntityStore::swap(EntityStore& other) {
+    std::swap(count_, other.count_);
+    std::swap(capacity_, other.capacity_);
+    std::swap(hot_, other.hot_);
+    std::swap(cold_, other.cold_);
+    std::swap(x, other.x);
+    std::swap(y, other.y);
+    std::swap(vx, other.vx);
+    std::swap(vy, other.vy);
+    std::swap(type, other.type);
+    std::swap(alive, other.alive);
+    std::swap(teleported, other.teleported);
+    std::swap(randomIndex, other.randomIndex);
+    std::swap(randomStream, other.randomStream);
+    std::swap(lastDirectionChangeTick, other.lastDirectionChangeTick);
+    std::swap(lastShotTick, other.lastShotTick);
+}
+
+void EntityStore::copyHotFrom(const EntityStore& other) {
+    if (capacity_ != other.capacity_) {
+        *this = other;
+        return;
+    }
+    count_ = other.count_;
+    if (capacity_)
+        memcpy(hot_, other.hot_, capacity_ * HOT_STRIDE);
+}
+
+void EntityStore::allocate(size_t count) {
+    // Round up so every array in a block starts on a cache line
+    capacity_ = (count + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE * CACHE_LINE_SIZE;
+    if (capacity_ == 0) {
+        hot_ = cold_ = nullptr;
+        x = y = vx = vy = nullptr;
+        type = alive = teleported = nullptr;
+        randomIndex = nullptr;
+        randomStream = nullptr;
+        lastDirectionChangeTick = lastShotTick = nullptr;
+        return;
+    }
+
+    hot_ = allocateBlock(capacity_ * HOT_STRIDE);
+    x = reinterpret_cast<float*>(hot_);
+    y = x + capacity_;
+    vx = y + capacity_;
+    vy = vx + capacity_;
+    type = reinterpret_cast<uint8_t*>(vy + capacity_);
+    alive = type + capacity_;
+    teleported = alive + capacity_;
+
+    cold_ = allocateBlock(capacity_ * COLD_STRIDE);
+    randomIndex = reinterpret_cast<uint64_t*>(cold_);
+    lastDirectionChangeTick = randomIndex + capacity_;
+    lastShotTick = lastDirectionChangeTick + capacity_;
+    randomStream = reinterpret_cast<uint32_t*>(lastShotTick + capacity_);
+}
+
+void EntityStore::release() {
+    freeBlock(hot_);
+    freeBlock(cold_);
+    hot_ = cold_ = nullptr;
+    count_ = capacity_ = 0;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+// Structure-of-arrays storage for everything that moves in the game.
+//
+// Each field is its own array so update loops stream through exactly the
+// data they touch and can be vectorized. Fields read every tick (hot) and
+// fields only enemy AI reads (cold) live in two separate blocks; every array
+// starts on a cache line, and copying a whole store is two memcpys.
+
+#include <cstddef>
+#include <cstdint>
+
+const size_t CACHE_LINE_SIZE = 64;
+
+enum EntityType : uint8_t {
+    ENTITY_PLAYER,
+    ENTITY_PLAYER_PROJECTILE,
+    ENTITY_ENEMY,
+    ENTITY_ENEMY_PROJECTILE
+};
+
+class EntityStore {
+public:
+    EntityStore() = default;
+    explicit EntityStore(size_t count) { resize(count); }
+    EntityStore(const EntityStore& other);
+    EntityStore& operator=(const EntityStore& other);
+    ~EntityStore();
+
+    // Grow or shrink to count entities. Existing entries keep their values,
+    // new ones start zeroed.
+    void resize(size_t count);
+    size_t size() const { return count_; }
+
+    // Copy only the hot block from a store of the same size
+    void copyHotFrom(const EntityStore& other);
+
+    // Hot: positions, velocities, type and alive flag
+    float* x = nullptr;
+    float* y = nullptr;
+    float* vx = nullptr;
+    float* vy = nullptr;
+    uint8_t* type = nullptr;
+    uint8_t* alive = nullptr;
+    // Set when the entity spawned or jumped during the last tick instead of
+    // moving, so rendering snaps it rather than interpolating
+    uint8_t* teleported = nullptr;
+
+    // Cold: enemy timers and random streams
+    uint64_t* randomIndex = nullptr;
+    uint32_t* randomStream = nullptr;
+    uint64_t* lastDirectionChangeTick = nullptr;
+    uint64_t* lastShotTick = nullptr;
+
+private:
+    void allocate(size_t count);
+    void release();
+    void swap(EntityStore& other);
+
+    size_t count_ = 0;
+    size_t capacity_ = 0;
+    unsigned char* hot_ = nullptr;
+    unsigned char* cold_ = nullptr;
+};
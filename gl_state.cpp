@@ -0,0 +1,65 @@
+#include "gl_state.h"
+
+#include <glad/glad.h>
+
+bool GlStateCache::changed(unsigned int& current, unsigned int wanted) {
+    if (current == wanted) {
+        skipped_++;
+        return false;
+    }
+    current = wanted;
+    issued_++;
+    return true;
+}
+
+void GlStateCache::useProgram(unsigned int program) {
+    if (changed(program_, program))
+        glUseProgram(program);
+}
+
+void GlStateCache::bindVertexArray(unsigned int vao) {
+    if (changed(vao_, vao))
+        glBindVertexArray(vao);
+}
+
+void GlStateCache::bindArrayBuffer(unsigned int buffer) {
+    if (changed(arrayBuffer_, buffer))
+        glBindBuffer(GL_ARRAY_BUFFER, buffer);
+}
+
+void GlStateCache::activeTexture(int unit) {
+    if (changed(activeUnit_, (unsigned int)unit))
+        glActiveTexture(GL_TEXTURE0 + unit);
+}
+
+void GlStateCache::bindTexture2D(unsigned int texture) {
+    // Untracked unit; always issue
+    if (activeUnit_ >= (unsigned int)TEXTURE_UNITS) {
+        issued_++;
+        glBindTexture(GL_TEXTURE_2D, texture);
+        return;
+    }
+    if (changed(textures_[activeUnit_], texture))
+        glBindTexture(GL_TEXTURE_2D, texture);
+}
+
+void GlStateCache::bindTexture2DArray(unsigned int texture) {
+    if (activeUnit_ >= (unsigned int)TEXTURE_UNITS) {
+        issued_++;
+        glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+        return;
+    }
+    if (changed(textureArrays_[activeUnit_], texture))
+        glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+}
+
+void GlStateCache::invalidate() {
+    program_ = UNKNOWN;
+    vao_ = UNKNOWN;
+    arrayBuffer_ = UNKNOWN;
+    activeUnit_ = UNKNOWN;
+    for (int i = 0; i < TEXTURE_UNITS; i++) {
+        textures_[i] = UNKNOWN;
+        textureArrays_[i] = UNKNOWN;
+    }
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+// Shadow copy of the GL binding state the renderer touches. Each bind goes
+// to GL only when it changes what is bound; redundant ones are skipped and
+// counted. Anything that binds behind the cache's back must call
+// invalidate() afterwards.
+
+#include <cstdint>
+
+class GlStateCache {
+public:
+    static const int TEXTURE_UNITS = 8;
+
+    GlStateCache() { invalidate(); }
+
+    void useProgram(unsigned int program);
+    void bindVertexArray(unsigned int vao);
+    void bindArrayBuffer(unsigned int buffer);
+    void activeTexture(int unit);
+    // Binds to GL_TEXTURE_2D / GL_TEXTURE_2D_ARRAY on the active unit
+    void bindTexture2D(unsigned int texture);
+    void bindTexture2DArray(unsigned int texture);
+
+    // Forget everything, so the next bind of each kind is always issued
+    void invalidate();
+    // Forget only the array buffer, after binding or deleting one directly
+    void forgetArrayBuffer() { arrayBuffer_ = UNKNOWN; }
+
+    uint64_t issuedCalls() const { return issued_; }
+    uint64_t skippedCalls() const { return skipped_; }
+    void resetCounters() { issued_ = 0; skipped_ = 0; }
+
+private:
+    // ~0u marks unknown state, which never matches a real object name
+    static const unsigned int UNKNOWN = ~0u;
+
+    bool changed(unsigned int& current, unsigned int wanted);
+
+    unsigned int program_;
+    unsigned int vao_;
+    unsigned int arrayBuffer_;
+    unsigned int activeUnit_;
+    unsigned int textures_[TEXTURE_UNITS];
+    unsigned int textureArrays_[TEXTURE_UNITS];
+    uint64_t issued_ = 0;
+    uint64_t skipped_ = 0;
+};
@@ -0,0 +1,153 @@
+#include "gpu_profiler.h"
+
+#include <glad/glad.h>
+
+#include <fstream>
+#include <iostream>
+
+GpuProfiler::~GpuProfiler() {
+    for (FrameQueries& f : ring_) {
+        if (f.queries[0])
+            glDeleteQueries(MAX_GPU_PASSES, f.queries);
+    }
+}
+
+void GpuProfiler::init() {
+    for (FrameQueries& f : ring_)
+        glGenQueries(MAX_GPU_PASSES, f.queries);
+}
+
+int GpuProfiler::addPass(const std::string& name) {
+    if (names_.size() >= (size_t)MAX_GPU_PASSES) {
+        std::cerr << "Too many GPU profiler passes, not timing " << name << "\n";
+        return -1;
+    }
+    names_.push_back(name);
+    return (int)names_.size() - 1;
+}
+
+void GpuProfiler::beginFrame() {
+    // Restarting a query discards its old result; try once more to read it
+    FrameQueries& f = ring_[current_];
+    if (f.pending) {
+        poll();
+        if (f.pending) {
+            f.pending = false;
+            dropped_++;
+        }
+    }
+    f.usedPasses = 0;
+    f.frame = nextFrame_++;
+}
+
+void GpuProfiler::beginPass(int pass) {
+    if (pass < 0)
+        return;
+    FrameQueries& f = ring_[current_];
+    glBeginQuery(GL_TIME_ELAPSED, f.queries[pass]);
+    f.usedPasses |= 1u << pass;
+    passActive_ = true;
+}
+
+void GpuProfiler::endPass() {
+    if (passActive_)
+        glEndQuery(GL_TIME_ELAPSED);
+    passActive_ = false;
+}
+
+void GpuProfiler::endFrame() {
+    ring_[current_].pending = ring_[current_].usedPasses != 0;
+    current_ = (current_ + 1) % GPU_PROFILER_FRAMES;
+}
+
+bool GpuProfiler::poll() {
+    // Oldest first, stopping at the first unfinished frame: later ones
+    // cannot be done before it
+    bool any = false;
+    for (int i = 0; i < GPU_PROFILER_FRAMES; i++) {
+        FrameQueries& f = ring_[(current_ + i) % GPU_PROFILER_FRAMES];
+        if (!f.pending)
+            continue;
+        // Queries finish in order, so the frame is done once its last one is
+        int last = 31 - __builtin_clz(f.usedPasses);
+        GLint available = 0;
+        glGetQueryObjectiv(f.queries[last], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+            break;
+
+        GpuFrameTimes times;
+        times.frame = f.frame;
+        for (int pass = 0; pass < passCount(); pass++) {
+            if (!(f.usedPasses & (1u << pass)))
+                continue;
+            GLuint64 nanoseconds = 0;
+            glGetQueryObjectui64v(f.queries[pass], GL_QUERY_RESULT, &nanoseconds);
+            times.passMs[pass] = nanoseconds / 1.0e6;
+            times.totalMs += times.passMs[pass];
+            passSums_[pass] += times.passMs[pass];
+        }
+        f.pending = false;
+        totalSum_ += times.totalMs;
+        frames_++;
+        latest_ = times;
+        collected_.push_back(times);
+        if (recording_)
+            history_.push_back(times);
+        any = true;
+    }
+    return any;
+}
+
+bool GpuProfiler::nextFrame(GpuFrameTimes& times) {
+    if (nextCollected_ == collected_.size()) {
+        collected_.clear();
+        nextCollected_ = 0;
+        return false;
+    }
+    times = collected_[nextCollected_++];
+    return true;
+}
+
+bool GpuProfiler::writeCsv(const std::string& path) const {
+    std::ofstream file(path);
+    file << "frame";
+    for (const std::string& name : names_)
+        file << "," << name;
+    file << ",total\n";
+    for (const GpuFrameTimes& times : history_) {
+        file << times.frame;
+        for (int pass = 0; pass < passCount(); pass++)
+            file << "," << times.passMs[pass];
+        file << "," << times.totalMs << "\n";
+    }
+    if (!file) {
+        std::cerr << "Failed to write GPU profile: " << path << "\n";
+        return false;
+    }
+    return true;
+}
+
+bool GpuProfiler::writeJson(const std::string& path) const {
+    // Pass names are our own identifiers, so they need no escaping
+    std::ofstream file(path);
+    file << "{\n  \"passes\": [";
+    for (int pass = 0; pass < passCount(); pass++)
+        file << (pass ? ", \"" : "\"") << names_[pass] << "\"";
+    file << "],\n  \"averageMs\": {";
+    for (int pass = 0; pass < passCount(); pass++)
+        file << (pass ? ", \"" : "\"") << names_[pass] << "\": " << averageMs(pass);
+    file << (passCount() ? ", " : "") << "\"total\": " << averageTotalMs() << "},\n  \"frames\": [";
+    for (size_t i = 0; i < history_.size(); i++) {
+        const GpuFrameTimes& times = history_[i];
+        file << (i ? ",\n    " : "\n    ") << "{\"frame\": " << times.frame;
+        for (int pass = 0; pass < passCount(); pass++)
+            file << ", \"" << names_[pass] << "\": " << times.passMs[pass];
+        file << ", \"total\": " << times.totalMs << "}";
+    }
+    file << (history_.empty() ? "]\n}\n" : "\n  ]\n}\n");
+    if (!file) {
+        std::cerr << "Failed to write GPU profile: " << path << "\n";
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+// GPU time per render pass, from GL_TIME_ELAPSED queries.
+//
+// Every frame gets its own set of queries, one per pass, from a ring of
+// GPU_PROFILER_FRAMES frames. poll() only reads frames whose queries have
+// all finished, so profiling never waits for the GPU; results arrive a
+// frame or two late. Only one GL_TIME_ELAPSED query can be active at a
+// time, so passes must not overlap or nest.
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+const int GPU_PROFILER_FRAMES = 3;
+const int MAX_GPU_PASSES = 8;
+
+// Results of one frame; passes that did not run that frame read 0
+struct GpuFrameTimes {
+    uint64_t frame = 0;
+    double passMs[MAX_GPU_PASSES] = {};
+    double totalMs = 0.0;
+};
+
+class GpuProfiler {
+public:
+    GpuProfiler() = default;
+    ~GpuProfiler();
+    GpuProfiler(const GpuProfiler&) = delete;
+    GpuProfiler& operator=(const GpuProfiler&) = delete;
+
+    // Needs a current GL context, which must still be current when the
+    // profiler is destroyed
+    void init();
+    // Register a pass before the first frame; returns its index, or -1
+    // past MAX_GPU_PASSES
+    int addPass(const std::string& name);
+    int passCount() const { return (int)names_.size(); }
+    const std::string& passName(int pass) const { return names_[pass]; }
+
+    void beginFrame();
+    void beginPass(int pass);
+    void endPass();
+    void endFrame();
+
+    // Collect every finished frame; returns true if any arrived. Frames
+    // collected here or by beginFrame() queue up until taken.
+    bool poll();
+    // Take the oldest collected frame not taken yet; false once none are left
+    bool nextFrame(GpuFrameTimes& times);
+    const GpuFrameTimes& latest() const { return latest_; }
+    // Averages over every collected frame
+    double averageMs(int pass) const { return frames_ ? passSums_[pass] / frames_ : 0.0; }
+    double averageTotalMs() const { return frames_ ? totalSum_ / frames_ : 0.0; }
+    uint64_t frames() const { return frames_; }
+    // Frames overwritten before they were read, because the GPU fell more
+    // than GPU_PROFILER_FRAMES frames behind
+    uint64_t dropped() const { return dropped_; }
+
+    // Keep every collected frame for the exporters
+    void setRecording(bool recording) { recording_ = recording; }
+    // One row per frame: frame, each pass, total (milliseconds)
+    bool writeCsv(const std::string& path) const;
+    // Pass names, averages and every frame as an object keyed by pass name
+    bool writeJson(const std::string& path) const;
+
+private:
+    struct FrameQueries {
+        unsigned int queries[MAX_GPU_PASSES] = {};
+        uint32_t usedPasses = 0; // bit per pass begun this frame
+        uint64_t frame = 0;
+        bool pending = false;
+    };
+
+    std::vector<std::string> names_;
+    FrameQueries ring_[GPU_PROFILER_FRAMES];
+    int current_ = 0;
+    uint64_t nextFrame_ = 0;
+    bool passActive_ = false;
+    GpuFrameTimes latest_;
+    std::vector<GpuFrameTimes> collected_;
+    size_t nextCollected_ = 0;
+    double passSums_[MAX_GPU_PASSES] = {};
+    double totalSum_ = 0.0;
+    uint64_t frames_ = 0;
+    uint64_t dropped_ = 0;
+    bool recording_ = false;
+    std::vector<GpuFrameTimes> history_;
+};
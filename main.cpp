@@ -7,95 +7,359 @@
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
 #include <glm/glm.hpp> // Include GLM for glm::vec3
 
+#include "asset_cache.h"
+#include "asset_pack.h"
+#include "atlas.h"
+#include "bench.h"
+#include "collide_simd.h"
+#include "cpu_profiler.h"
+#include "dynamic_resolution.h"
+#include "gl_state.h"
+#include "gpu_profiler.h"
+#include "program_cache.h"
+#include "render_queue.h"
+#include "replay.h"
+#include "shader.h"
+#include "shader_library.h"
+#include "sim.h"
+#include "sprite_batch.h"
+#include "sprites.h"
+#include "texture_array.h"
+
 // Window dimensions
 const unsigned int SCR_WIDTH = 800;
 const unsigned int SCR_HEIGHT = 600;
 
-// Player position
-float playerX = 0.0f, playerY = 0.0f;
-const float playerSpeed = 0.01f;
+// Sprite quads are the unit quad at this scale
+const float SPRITE_SCALE = 0.1f;
+
+// Sprite centres that can still cover part of the screen. There is no camera
+// yet, so the view is the whole clip-space square.
+const ViewRect SCREEN_VIEW = { -1.0f - SPRITE_SCALE, -1.0f - SPRITE_SCALE, 1.0f + SPRITE_SCALE, 1.0f + SPRITE_SCALE };
+
+// Written by atlas_bake; optional
+const char* ATLAS_TABLE_PATH = "textures/atlas/atlas.txt";
+const char* ATLAS_IMAGE_PATH = "textures/atlas/atlas.tga";
+
+// Sprite shader; variants come from #defines, see shader_library.h
+const char* SHADER_VERTEX_PATH = "background.vs";
+const char* SHADER_FRAGMENT_PATH = "background.fs";
+
+// Linked program binaries, see program_cache.h
+const char* SHADER_CACHE_DIR = "shader_cache";
+
+// Written by asset_bake; optional
+const char* ASSET_PACK_PATH = "textures/assets.pack";
+
+// Render passes in draw order. Each is a render queue layer of the batched
+// renderer and is timed on the GPU on its own; the upscale of the offscreen
+// scene follows as a last, post-processing pass.
+enum RenderPass : uint32_t {
+    PASS_BACKGROUND,
+    PASS_PLAYERS,
+    PASS_ENEMIES,
+    PASS_PROJECTILES,
+    SCENE_PASS_COUNT
+};
+const char* const RENDER_PASS_NAMES[SCENE_PASS_COUNT] = { "background", "players", "enemies", "projectiles" };
+
+uint32_t spritePass(uint16_t type) {
+    switch (type) {
+    case ENTITY_ENEMY: return PASS_ENEMIES;
+    case ENTITY_PLAYER_PROJECTILE:
+    case ENTITY_ENEMY_PROJECTILE: return PASS_PROJECTILES;
+    default: return PASS_PLAYERS;
+    }
+}
+
+// CPU zone trace (MYSTIC_PROFILE builds), written on exit and, in the
+// windowed game, on the key
+const char* CPU_TRACE_PATH = "cpu_trace.json";
+const int CPU_TRACE_KEY = GLFW_KEY_F12;
 
-// Enemy positions
-float enemyPositions[3][2] = {
-    { 0.3f,  0.3f },
-    { -0.5f, -0.2f },
-    { 0.7f, -0.5f }
+// How often --gpu-overlay refreshes the per-pass times in the window title
+const double GPU_OVERLAY_INTERVAL = 0.5;
+
+// Where the batched renderer takes a sprite's pixels from: a whole texture,
+// a region of the atlas texture or a layer of the texture array
+struct SpriteSource {
+    unsigned int texture;
+    const AtlasRegion* region;
+    float layer = 0.0f;
 };
 
-// Vertex Shader Source
-const char* vertexShaderSource = R"(
-#version 330 core
-layout (location = 0) in vec3 aPos;
-layout (location = 1) in vec2 aTexCoord;
+// Command line settings
+struct Options {
+    bool headless = false;
+    bool stress = false;
+    bool benchCollision = false;
+    long ticks = 0; // 0 = mode default
+    int simHz = DEFAULT_SIM_HZ;
+    uint64_t seed = DEFAULT_SEED;
+    int enemies = DEFAULT_ENEMY_COUNT;
+    const char* recordPath = nullptr;
+    const char* replayPath = nullptr;
+    bool shaderCache = true;
+    bool batched = true; // instanced sprite batches, or one draw per sprite
+    bool persistentBuffers = true; // persistent-mapped streaming when GL 4.4 allows
+    bool vertexIdQuads = true;     // batched quads from gl_VertexID, no vertex buffer
+    bool textureArray = false;     // batched sprites from one GL_TEXTURE_2D_ARRAY
+    float renderScale = 0.0f;      // fixed offscreen resolution scale; 0 = adaptive
+    double gpuBudgetMs = 0.0;      // adaptive scale target; 0 = monitor refresh interval
+    const char* gpuProfilePath = nullptr; // per-pass GPU times, .json or CSV
+    bool gpuOverlay = false;       // per-pass GPU times in the window title
+};
 
-uniform vec2 offset;
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
 
-out vec2 TexCoord;
+// Sample every key the simulation cares about
+SimInput readInput(GLFWwindow* window) {
+    PROFILE_ZONE("input");
+    static const struct { int key; uint32_t bit; } bindings[] = {
+        { GLFW_KEY_W, INPUT_P1_W }, { GLFW_KEY_A, INPUT_P1_A },
+        { GLFW_KEY_S, INPUT_P1_S }, { GLFW_KEY_D, INPUT_P1_D },
+        { GLFW_KEY_UP, INPUT_P1_UP }, { GLFW_KEY_DOWN, INPUT_P1_DOWN },
+        { GLFW_KEY_LEFT, INPUT_P1_LEFT }, { GLFW_KEY_RIGHT, INPUT_P1_RIGHT },
+        { GLFW_KEY_Z, INPUT_P1_FIRE_RIGHT }, { GLFW_KEY_X, INPUT_P1_FIRE_LEFT },
+        { GLFW_KEY_I, INPUT_P2_UP }, { GLFW_KEY_J, INPUT_P2_LEFT },
+        { GLFW_KEY_K, INPUT_P2_DOWN }, { GLFW_KEY_L, INPUT_P2_RIGHT },
+        { GLFW_KEY_O, INPUT_P2_FIRE_RIGHT }, { GLFW_KEY_P, INPUT_P2_FIRE_LEFT }
+    };
 
-void main()
-{
-    gl_Position = vec4(aPos.x + offset.x, aPos.y + offset.y, aPos.z, 1.0);
-    TexCoord = aTexCoord;
+    SimInput input;
+    for (const auto& b : bindings) {
+        if (glfwGetKey(window, b.key) == GLFW_PRESS)
+            input.keys |= b.bit;
+    }
+    return input;
 }
-)";
 
-// Fragment Shader Source
-const char* fragmentShaderSource = R"(
-#version 330 core
-out vec4 FragColor;
+// Scripted input for headless runs: hold a pseudo-random set of keys for a
+// short while, then pick another, so every rule in the simulation gets hit.
+SimInput autopilotInput(long tick) {
+    uint32_t h = (uint32_t)(tick / 20) * 2654435761u;
+    h ^= h >> 15;
+    h *= 2246822519u;
+    h ^= h >> 13;
+
+    SimInput input;
+    input.keys = h & (INPUT_P1_UP | INPUT_P1_DOWN | INPUT_P1_LEFT | INPUT_P1_RIGHT |
+                      INPUT_P1_FIRE_RIGHT | INPUT_P1_FIRE_LEFT |
+                      INPUT_P2_UP | INPUT_P2_LEFT | INPUT_P2_DOWN | INPUT_P2_RIGHT |
+                      INPUT_P2_FIRE_RIGHT | INPUT_P2_FIRE_LEFT);
+    return input;
+}
 
-in vec2 TexCoord;
+struct RunTotals {
+    uint32_t gamesCompleted = 0;
+    uint32_t totalScore = 0;
+    double seconds = 0.0;
+};
 
-uniform sampler2D texture1;
+// Step the simulation with no window or GL context, starting a new game
+// whenever one ends. input(t) supplies the keys for tick t.
+template <typename InputSource>
+RunTotals runTicks(Simulation& sim, long ticks, InputSource input) {
+    RunTotals totals;
+    auto start = std::chrono::steady_clock::now();
+    for (long t = 0; t < ticks; t++) {
+        sim.step(input(t));
+        if (sim.state().gameOver) {
+            totals.totalScore += sim.state().score;
+            totals.gamesCompleted++;
+            sim.reset();
+        }
+    }
+    totals.seconds = secondsSince(start);
+    totals.totalScore += sim.state().score;
+    return totals;
+}
 
-void main()
-{
-    FragColor = texture(texture1, TexCoord);
+void printRunReport(const char* label, uint64_t seed, long ticks, const Simulation& sim, const RunTotals& totals) {
+    std::cout << label << ": seed 0x" << std::hex << seed << std::dec << ", " << sim.state().enemyCount << " enemies, " << ticks << " ticks ("
+              << ticks * (double)sim.tickSeconds() << " s of game time), " << totals.gamesCompleted << " games completed, "
+              << totals.totalScore << " enemies killed\n";
+    std::cout << "Elapsed: " << totals.seconds << " s ("
+              << (totals.seconds > 0.0 ? ticks / totals.seconds : 0.0) << " ticks/s)\n";
 }
-)";
 
-// Load texture from file
-unsigned int loadTexture(const char* path) {
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
-    
-    int width, height, nrChannels;
-    unsigned char* data = stbi_load(path, &width, &height, &nrChannels, 0);
-    
-    if (data) {
-        GLenum format = nrChannels == 4 ? GL_RGBA : GL_RGB;
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-        
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);  
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);  
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);  
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    } else {
-        std::cerr << "Failed to load texture: " << path << "\n";
+// Run the autopilot headless, optionally recording its input
+int runHeadless(const Options& options) {
+    const long ticks = options.ticks ? options.ticks : 100000;
+    const char* recordPath = options.recordPath;
+    Simulation sim(options.simHz, options.seed, options.enemies);
+    Replay replay;
+    replay.simHz = (uint16_t)options.simHz;
+    replay.seed = options.seed;
+    replay.enemyCount = (uint32_t)options.enemies;
+
+    RunTotals totals = runTicks(sim, ticks, [&](long t) {
+        SimInput input = autopilotInput(t);
+        if (recordPath)
+            replay.ticks.push_back((uint16_t)input.keys);
+        return input;
+    });
+    printRunReport("Headless", options.seed, ticks, sim, totals);
+    if (CPU_PROFILER_ENABLED)
+        writeChromeTrace(CPU_TRACE_PATH);
+
+    if (recordPath) {
+        replay.gamesCompleted = totals.gamesCompleted;
+        replay.totalScore = totals.totalScore;
+        if (!saveReplay(recordPath, replay))
+            return -1;
     }
-    
-    stbi_image_free(data);
-    return textureID;
+    return 0;
 }
 
-void processInput(GLFWwindow* window) {
-    if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
-        playerY += playerSpeed;
-    if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
-        playerY -= playerSpeed;
-    if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
-        playerX -= playerSpeed;
-    if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
-        playerX += playerSpeed;
+// Re-run a recorded game at full speed and check it ends the same way
+int runReplay(const char* path) {
+    Replay replay;
+    if (!loadReplay(path, replay))
+        return -1;
+
+    Simulation sim(replay.simHz, replay.seed, (int)replay.enemyCount);
+    long ticks = (long)replay.ticks.size();
+    RunTotals totals = runTicks(sim, ticks, [&](long t) {
+        SimInput input;
+        input.keys = replay.ticks[t];
+        return input;
+    });
+    printRunReport("Replay", replay.seed, ticks, sim, totals);
+    if (CPU_PROFILER_ENABLED)
+        writeChromeTrace(CPU_TRACE_PATH);
+
+    if (totals.gamesCompleted != replay.gamesCompleted || totals.totalScore != replay.totalScore) {
+        std::cerr << "Replay diverged: recorded " << replay.gamesCompleted << " games / " << replay.totalScore
+                  << " kills, got " << totals.gamesCompleted << " / " << totals.totalScore << "\n";
+        return 1;
+    }
+    return 0;
+}
+
+// Wall time per phase of a tick or frame, averaged over a run
+struct PhaseTimes {
+    double update = 0.0;
+    double collision = 0.0;
+    double render = 0.0;
+    double renderSort = 0.0; // only timed by the stress run
+    long submitted = 0;      // sprites kept and dropped by view culling
+    long culled = 0;
+    long samples = 0;
+
+    void addCull(const CullStats& stats) {
+        submitted += stats.submitted;
+        culled += stats.culled;
+    }
+
+    void print(const char* renderLabel) const {
+        double n = samples ? (double)samples : 1.0;
+        std::cout << "  update    " << update * 1000.0 / n << " ms\n"
+                  << "  collision " << collision * 1000.0 / n << " ms\n"
+                  << "  " << renderLabel << " " << render * 1000.0 / n << " ms\n";
+        if (renderSort > 0.0)
+            std::cout << "  render sort " << renderSort * 1000.0 / n << " ms\n";
+        std::cout << "  sprites   " << submitted / n << " submitted, " << culled / n << " culled\n";
+    }
+};
+
+// Headless scaling sweep: 1k, 10k and 100k enemies, each with its own
+// projectile, timing update, collision and render preparation per tick.
+// Nothing ends the game here, so every tick sees the full entity count.
+int runStress(const Options& options) {
+    const long ticks = options.ticks ? options.ticks : 600;
+    const int counts[] = { 1000, 10000, 100000 };
+    std::vector<SpriteInstance> sprites;
+    RenderQueue queue;
+
+    for (int count : counts) {
+        Simulation sim(options.simHz, options.seed, count);
+        PhaseTimes times;
+        long liveProjectiles = 0;
+        for (long t = 0; t < ticks; t++) {
+            auto start = std::chrono::steady_clock::now();
+            sim.update(autopilotInput(t));
+            times.update += secondsSince(start);
+
+            start = std::chrono::steady_clock::now();
+            sim.resolveCollisions();
+            times.collision += secondsSince(start);
+
+            start = std::chrono::steady_clock::now();
+            sprites.clear();
+            times.addCull(collectSprites(sim.previousState().entities, sim.state().entities, FIRST_ENEMY, 0.5f,
+                                         SCREEN_VIEW, sprites));
+            times.render += secondsSince(start);
+
+            // The keys the batched renderer would sort, one texture per
+            // sprite type and variant
+            start = std::chrono::steady_clock::now();
+            queue.clear();
+            for (size_t i = 0; i < sprites.size(); i++) {
+                uint32_t texture = sprites[i].type * ENEMY_VARIANTS + sprites[i].variant;
+                queue.push(makeRenderKey(spritePass(sprites[i].type), 0, texture, 0), (uint32_t)i);
+            }
+            queue.sort();
+            times.renderSort += secondsSince(start);
+            times.samples++;
+        }
+        const SimState& s = sim.state();
+        for (int i = 0; i < count; i++)
+            liveProjectiles += s.entities.alive[s.enemyProjectile(i)];
+
+        std::cout << "Stress: " << count << " enemies, " << liveProjectiles << " live enemy projectiles at the end, "
+                  << ticks << " ticks, per tick:\n";
+        times.print("render prep (sprite list, no GL)");
+    }
+    return 0;
 }
 
-int main() {
+// Draw one sprite through the shared quad; offsetLocation is the cached
+// location of the shader's offset uniform
+void drawSprite(GlStateCache& state, const ShaderProgram& shader, int offsetLocation, unsigned int vao, unsigned int texture, float x, float y) {
+    shader.setVec2(offsetLocation, x, y);
+    state.bindTexture2D(texture);
+    state.bindVertexArray(vao);
+    glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+}
+
+// The windowed game. Every GL object lives in here, so everything that
+// owns one is destroyed before the caller terminates GLFW.
+int runWindowed(const Options& options) {
+    // Textures in the baked pack upload straight from its mapping. The rest
+    // decode on worker threads while the window and context are created and
+    // upload below as each one is acquired. Repeated paths and identical
+    // files share one texture.
+    stbi_set_flip_vertically_on_load(true);
+    TextureCache textures;
+    AssetPack pack;
+    if (std::ifstream(ASSET_PACK_PATH) && pack.open(ASSET_PACK_PATH))
+        textures.setPack(&pack);
+    std::vector<std::string> texturePaths = {
+        "textures/grass.png", "textures/player.png", "textures/enemy.png",
+        "textures/bullet.png", "textures/attack.png"
+    };
+    if (std::ifstream(ATLAS_TABLE_PATH))
+        texturePaths.push_back(ATLAS_IMAGE_PATH);
+    texturePaths.erase(std::remove_if(texturePaths.begin(), texturePaths.end(),
+                                      [&](const std::string& path) { return pack.find(path) != nullptr; }),
+                       texturePaths.end());
+    // The texture array is built from the same decodes
+    textures.setKeepPixels(options.textureArray && options.batched);
+    textures.prefetch(texturePaths);
+
     // GLFW initialization
-    int score = 0;
     glfwInit();
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
@@ -104,7 +368,6 @@ int main() {
     GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "Mystic Brawl", nullptr, nullptr);
     if (!window) {
         std::cerr << "Failed to create GLFW window\n";
-        glfwTerminate();
         return -1;
     }
     glfwMakeContextCurrent(window);
@@ -120,22 +383,32 @@ int main() {
     glEnable(GL_BLEND);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-    // Compile shaders
-    unsigned int vertexShader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertexShader, 1, &vertexShaderSource, nullptr);
-    glCompileShader(vertexShader);
-    
-    unsigned int fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragmentShader, 1, &fragmentShaderSource, nullptr);
-    glCompileShader(fragmentShader);
-
-    unsigned int shader = glCreateProgram();
-    glAttachShader(shader, vertexShader);
-    glAttachShader(shader, fragmentShader);
-    glLinkProgram(shader);
-    
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
+    // Build every shader variant now, from the program binary cache where
+    // possible and on the driver's compiler threads where it has them
+    auto shaderStart = std::chrono::steady_clock::now();
+    ProgramBinaryCache programCache(SHADER_CACHE_DIR);
+    if (options.shaderCache)
+        programCache.init();
+    ProgramBinaryCache* cache = programCache.enabled() ? &programCache : nullptr;
+    bool parallelCompile = glfwExtensionSupported("GL_KHR_parallel_shader_compile");
+    if (parallelCompile) {
+        typedef void (APIENTRYP MaxShaderCompilerThreadsProc)(GLuint count);
+        auto maxShaderCompilerThreads = (MaxShaderCompilerThreadsProc)glfwGetProcAddress("glMaxShaderCompilerThreadsKHR");
+        if (maxShaderCompilerThreads)
+            maxShaderCompilerThreads(0xFFFFFFFFu); // as many as the driver likes
+    }
+    ShaderLibrary shaders;
+    if (!shaders.load(SHADER_VERTEX_PATH, SHADER_FRAGMENT_PATH) || !shaders.buildAll(cache, parallelCompile)) {
+        return -1;
+    }
+    const ShaderProgram& shader = shaders.get(0);
+    std::cout << "Shaders ready in " << secondsSince(shaderStart) * 1000.0 << " ms, "
+              << ShaderLibrary::validVariantCount() << " variants" << (parallelCompile ? " in parallel (" : " (");
+    if (cache)
+        std::cout << programCache.hits() << " from cache, " << programCache.misses() << " compiled)\n";
+    else
+        std::cout << "cache " << (options.shaderCache ? "unsupported" : "disabled") << ")\n";
+    const int offsetLocation = shader.uniform("offset");
 
     // Vertex data
     float playerVertices[] = {
@@ -193,325 +466,438 @@ int main() {
     glEnableVertexAttribArray(1);
 
     // Load textures
-    stbi_set_flip_vertically_on_load(true);
-    unsigned int bgTexture = loadTexture("textures/grass.png");
-    unsigned int playerTexture = loadTexture("textures/player.png");
+    unsigned int bgTexture = textures.acquire("textures/grass.png");
+    unsigned int playerTexture = textures.acquire("textures/player.png");
+
+    // Load enemy textures; the variants share one texture until they get
+    // their own art
+    unsigned int enemyTextures[ENEMY_VARIANTS];
+    enemyTextures[0] = textures.acquire("textures/enemy.png");
+    enemyTextures[1] = textures.acquire("textures/enemy.png");
+    enemyTextures[2] = textures.acquire("textures/enemy.png");
+
+
+    unsigned int bulletTexture = textures.acquire("textures/bullet.png");
+    unsigned int axeTexture = textures.acquire("textures/attack.png");
+
+    SpriteSource bgSource = { bgTexture, nullptr };
+    SpriteSource playerSource = { playerTexture, nullptr };
+    SpriteSource bulletSource = { bulletTexture, nullptr };
+    SpriteSource axeSource = { axeTexture, nullptr };
+    SpriteSource enemySources[ENEMY_VARIANTS];
+    for (int v = 0; v < ENEMY_VARIANTS; v++)
+        enemySources[v] = { enemyTextures[v], nullptr };
+
+    // With a baked atlas every batched sprite shares one texture, so a frame
+    // is a single draw call
+    SpriteAtlas atlas;
+    if (!std::ifstream(ATLAS_TABLE_PATH)) {
+        std::cout << "No texture atlas at " << ATLAS_TABLE_PATH << " (run atlas_bake), using separate textures\n";
+    } else if (loadAtlas(ATLAS_TABLE_PATH, atlas)) {
+        const AtlasRegion* grass = atlas.find("grass");
+        const AtlasRegion* player = atlas.find("player");
+        const AtlasRegion* enemy = atlas.find("enemy");
+        const AtlasRegion* bullet = atlas.find("bullet");
+        const AtlasRegion* attack = atlas.find("attack");
+        if (grass && player && enemy && bullet && attack) {
+            unsigned int atlasTexture = textures.acquire(ATLAS_IMAGE_PATH);
+            bgSource = { atlasTexture, grass };
+            playerSource = { atlasTexture, player };
+            bulletSource = { atlasTexture, bullet };
+            axeSource = { atlasTexture, attack };
+            for (int v = 0; v < ENEMY_VARIANTS; v++)
+                enemySources[v] = { atlasTexture, enemy };
+        } else {
+            std::cerr << "Texture atlas is missing sprites, using separate textures\n";
+        }
+    }
+    textures.report(std::cout);
+
+    // A texture array holds every sprite as a layer with its own mips; the
+    // frame is again one draw call, with no atlas bleeding
+    bool useTextureArray = false;
+    TextureArray textureArray;
+    if (options.textureArray && options.batched) {
+        if (textureArray.load(textures, { "textures/grass.png", "textures/player.png", "textures/enemy.png",
+                                          "textures/bullet.png", "textures/attack.png" })) {
+            unsigned int arrayTexture = textureArray.texture();
+            bgSource = { arrayTexture, nullptr, 0.0f };
+            playerSource = { arrayTexture, nullptr, 1.0f };
+            for (int v = 0; v < ENEMY_VARIANTS; v++)
+                enemySources[v] = { arrayTexture, nullptr, 2.0f };
+            bulletSource = { arrayTexture, nullptr, 3.0f };
+            axeSource = { arrayTexture, nullptr, 4.0f };
+            useTextureArray = true;
+            std::cout << "Texture array: " << textureArray.layers() << " layers of " << textureArray.width() << "x"
+                      << textureArray.height() << "\n";
+        }
+        textures.dropPixels();
+    }
 
-    // Load enemy textures
-    unsigned int enemyTextures[3];
-    enemyTextures[0] = loadTexture("textures/enemy.png");
-    enemyTextures[1] = loadTexture("textures/enemy.png");
-    enemyTextures[2] = loadTexture("textures/enemy.png");
+    uint32_t batchVariant = SHADER_INSTANCED;
+    batchVariant |= useTextureArray ? SHADER_TEXTURE_ARRAY : SHADER_ATLAS;
+    if (options.vertexIdQuads)
+        batchVariant |= SHADER_VERTEX_ID;
+    const ShaderProgram& instancedShader = shaders.get(batchVariant);
 
+    SpriteBatch spriteBatch;
+    SpriteBatchOptions batchOptions;
+    batchOptions.persistentBuffers = options.persistentBuffers;
+    batchOptions.vertexIdQuads = options.vertexIdQuads;
+    batchOptions.textureArrays = useTextureArray;
+    spriteBatch.init(batchOptions);
+
+    // Setup above bound objects directly; from here every bind in the frame
+    // loop goes through the cache
+    GlStateCache glState;
+    glState.activeTexture(0);
 
-    // Render loop
-    unsigned int bulletTexture = loadTexture("textures/bullet.png");
     // Set the window to full screen
     const GLFWvidmode* mode = glfwGetVideoMode(glfwGetPrimaryMonitor());
     glfwSetWindowMonitor(window, glfwGetPrimaryMonitor(), 0, 0, mode->width, mode->height, mode->refreshRate);
     glViewport(0, 0, mode->width, mode->height);
-    float st = 0;
-    while (!glfwWindowShouldClose(window)) {
-        processInput(window);
-
-        glClearColor(0.1f, 0.2f, 0.2f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT);
-        
-        // Draw background
-        glUseProgram(shader);
-        glUniform2f(glGetUniformLocation(shader, "offset"), 0.0f, 0.0f);
-        glBindTexture(GL_TEXTURE_2D, bgTexture);
-        glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
-
-        // Draw player
-        glUniform2f(glGetUniformLocation(shader, "offset"), playerX, playerY);
-        glBindTexture(GL_TEXTURE_2D, playerTexture);
-        glBindVertexArray(playerVAO);
-        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
-        // Additional player movement using arrow keys
-        if (glfwGetKey(window, GLFW_KEY_UP) == GLFW_PRESS && playerY + 0.1f < 1.0f)
-            playerY += playerSpeed;
-        if (glfwGetKey(window, GLFW_KEY_DOWN) == GLFW_PRESS && playerY - 0.1f > -1.0f)
-            playerY -= playerSpeed;
-        if (glfwGetKey(window, GLFW_KEY_LEFT) == GLFW_PRESS && playerX - 0.1f > -1.0f)
-            playerX -= playerSpeed;
-        if (glfwGetKey(window, GLFW_KEY_RIGHT) == GLFW_PRESS && playerX + 0.1f < 1.0f)
-            playerX += playerSpeed;
-
-        // Draw player 2
-        static float player2X = 0.5f, player2Y = 0.5f; // Initial position for player 2
-        static bool player2ProjectileActive = false;
-        static float player2ProjectileX = player2X, player2ProjectileY = player2Y;
-        static bool player2SpacePressed = false;
-        static bool player2AttackLeftActive = false;
-        static bool player2AttackRightActive = false;
-        static bool player2LeftPressed = false;
-        static bool player2RightPressed = false;
-
-        // Handle player 2 movement
-        if (glfwGetKey(window, GLFW_KEY_I) == GLFW_PRESS && player2Y + 0.1f < 1.0f)
-            player2Y += playerSpeed;
-        if (glfwGetKey(window, GLFW_KEY_K) == GLFW_PRESS && player2Y - 0.1f > -1.0f)
-            player2Y -= playerSpeed;
-        if (glfwGetKey(window, GLFW_KEY_J) == GLFW_PRESS && player2X - 0.1f > -1.0f)
-            player2X -= playerSpeed;
-        if (glfwGetKey(window, GLFW_KEY_L) == GLFW_PRESS && player2X + 0.1f < 1.0f)
-            player2X += playerSpeed;
-
-        // Draw player 2
-        glUniform2f(glGetUniformLocation(shader, "offset"), player2X, player2Y);
-        glBindTexture(GL_TEXTURE_2D, playerTexture);
-        glBindVertexArray(playerVAO);
-        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
-
-
-        // Handle player 2 left attack
-        if (!player2AttackLeftActive && !player2AttackRightActive && glfwGetKey(window, GLFW_KEY_P) == GLFW_PRESS && !player2LeftPressed) {
-            player2LeftPressed = true;
-            player2ProjectileX = player2X;
-            player2ProjectileY = player2Y;
-            player2AttackLeftActive = true;
-        }
-        if (glfwGetKey(window, GLFW_KEY_P) == GLFW_RELEASE) {
-            player2LeftPressed = false;
-        }
-
-        if (player2AttackLeftActive) {
-            player2ProjectileX -= 0.05f; // Move projectile to the left
 
-            // Draw player 2 left attack projectile
-            glUniform2f(glGetUniformLocation(shader, "offset"), player2ProjectileX, player2ProjectileY);
-            glBindTexture(GL_TEXTURE_2D, bulletTexture); // Use bullet texture
-            glBindVertexArray(playerVAO); // Reusing player VAO
-            glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+    // The scene renders offscreen at a scale that keeps GPU frame time within
+    // one refresh interval (or --gpu-budget-ms), then upscales to the screen
+    DynamicResolutionOptions resolutionOptions;
+    resolutionOptions.fixedScale = options.renderScale;
+    if (options.gpuBudgetMs > 0.0)
+        resolutionOptions.budgetMs = options.gpuBudgetMs;
+    else if (mode->refreshRate > 0)
+        resolutionOptions.budgetMs = 1000.0 / mode->refreshRate;
+    DynamicResolution resolution;
+    const bool scaledRendering = resolution.init(mode->width, mode->height, resolutionOptions);
+    if (!scaledRendering)
+        std::cerr << "Rendering at full resolution\n";
+
+    // Every pass is timed on the GPU; the totals also drive the resolution
+    GpuProfiler gpuProfiler;
+    gpuProfiler.init();
+    for (const char* name : RENDER_PASS_NAMES)
+        gpuProfiler.addPass(name);
+    const int upscalePass = gpuProfiler.addPass("upscale");
+    gpuProfiler.setRecording(options.gpuProfilePath != nullptr);
+    GpuFrameTimes overlayTimes;
+    long overlayFrames = 0;
+    double lastOverlayTime = glfwGetTime();
 
-            // Deactivate projectile if it goes out of bounds
-            if (player2ProjectileX < -1.0f) {
-            player2AttackLeftActive = false;
-            }
+    // Render loop
+    // The simulation runs at a fixed rate; each frame consumes whole ticks
+    // from the accumulator and renders the remainder as an interpolation.
+    Simulation sim(options.simHz, options.seed, options.enemies);
+    Replay replay;
+    replay.simHz = (uint16_t)options.simHz;
+    replay.seed = options.seed;
+    replay.enemyCount = (uint32_t)options.enemies;
+    PhaseTimes times;
+    std::vector<SpriteInstance> sprites;
+    const double tickSeconds = sim.tickSeconds();
+    double accumulator = 0.0;
+    double lastTime = glfwGetTime();
+    bool traceKeyHeld = false;
+    PROFILE_THREAD("main");
+    while (!glfwWindowShouldClose(window)) {
+        if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS) {
+            std::cout << "Game Over" << std::endl << "Enemies Killed: " << sim.state().score << std::endl;
+            break;
         }
 
-        if (!player2AttackLeftActive && !player2AttackRightActive && glfwGetKey(window, GLFW_KEY_O) == GLFW_PRESS && !player2RightPressed) {
-            player2RightPressed = true;
-            player2ProjectileX = player2X;
-            player2ProjectileY = player2Y;
-            player2AttackRightActive = true;
-        }
-        if (glfwGetKey(window, GLFW_KEY_O) == GLFW_RELEASE) {
-            player2RightPressed = false;
+        double now = glfwGetTime();
+        // Clamp long stalls so we never try to catch up on seconds of ticks
+        accumulator += std::min(now - lastTime, 0.25);
+        lastTime = now;
+
+        SimInput input = readInput(window);
+        while (accumulator >= tickSeconds && !sim.state().gameOver) {
+            auto phaseStart = std::chrono::steady_clock::now();
+            sim.update(input);
+            times.update += secondsSince(phaseStart);
+            phaseStart = std::chrono::steady_clock::now();
+            sim.resolveCollisions();
+            times.collision += secondsSince(phaseStart);
+
+            if (options.recordPath)
+                replay.ticks.push_back((uint16_t)input.keys);
+            accumulator -= tickSeconds;
         }
 
-        if (player2AttackRightActive) {
-            player2ProjectileX += 0.05f; // Move projectile to the right
-
-            // Draw player 2 right attack projectile
-            glUniform2f(glGetUniformLocation(shader, "offset"), player2ProjectileX, player2ProjectileY);
-            glBindTexture(GL_TEXTURE_2D, bulletTexture); // Use bullet texture
-            glBindVertexArray(playerVAO); // Reusing player VAO
-            glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
-
-            // Deactivate projectile if it goes out of bounds
-            if (player2ProjectileX > 1.0f) {
-            player2AttackRightActive = false;
-            }
+        const SimState& s = sim.state();
+        const SimState& prev = sim.previousState();
+        float alpha = (float)(accumulator / tickSeconds);
+        if (s.gameOver) {
+            std::cout << "Game Over" << std::endl << "Enemies Killed: " << s.score << std::endl;
+            glfwSetWindowShouldClose(window, true); // Close the window
+            alpha = 1.0f;
         }
 
-        // Check for collisions between player 2 projectile and enemies
-        if (player2ProjectileActive || player2AttackLeftActive || player2AttackRightActive) {
-            for (int i = 0; i < 3; i++) {
-            if (abs(player2ProjectileX - enemyPositions[i][0]) < 0.1f && abs(player2ProjectileY - enemyPositions[i][1]) < 0.1f) {
-                score++;
-                // Respawn enemy at a random position, ensuring it's not where the players are
-                do {
-                enemyPositions[i][0] = ((rand() % 200) - 100) / 100.0f; // Random value between -1.0 and 1.0
-                enemyPositions[i][1] = ((rand() % 200) - 100) / 100.0f; // Random value between -1.0 and 1.0
-                } while ((abs(enemyPositions[i][0] - playerX) < 0.2f && abs(enemyPositions[i][1] - playerY) < 0.2f) ||
-                     (abs(enemyPositions[i][0] - player2X) < 0.2f && abs(enemyPositions[i][1] - player2Y) < 0.2f));
-                
-                player2ProjectileActive = false; // Deactivate upward projectile
-                player2AttackLeftActive = false; // Deactivate left attack
-                player2AttackRightActive = false; // Deactivate right attack
-                break;
+        auto renderStart = std::chrono::steady_clock::now();
+        PROFILE_BEGIN(renderSubmission);
+        sprites.clear();
+        times.addCull(collectSprites(prev.entities, s.entities, FIRST_ENEMY, alpha, SCREEN_VIEW, sprites));
+        auto spriteTexture = [&](const SpriteInstance& sprite) {
+            switch (sprite.type) {
+            case ENTITY_PLAYER_PROJECTILE: return bulletTexture;
+            case ENTITY_ENEMY: return enemyTextures[sprite.variant];
+            case ENTITY_ENEMY_PROJECTILE: return axeTexture;
+            default: return playerTexture;
             }
+        };
+        auto spriteSource = [&](const SpriteInstance& sprite) {
+            switch (sprite.type) {
+            case ENTITY_PLAYER_PROJECTILE: return bulletSource;
+            case ENTITY_ENEMY: return enemySources[sprite.variant];
+            case ENTITY_ENEMY_PROJECTILE: return axeSource;
+            default: return playerSource;
             }
-        }
-        // Draw enemies
-        for (int i = 0; i < 3; i++) {
-            glUniform2f(glGetUniformLocation(shader, "offset"), enemyPositions[i][0], enemyPositions[i][1]);
-            glBindTexture(GL_TEXTURE_2D, enemyTextures[i]);
-            glBindVertexArray(playerVAO); // Reusing player VAO
-            glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
-        }
-
-    // Handle enemy movement
-    static float enemyMoveDirections[3][2] = { {0.0f, 0.0f}, {0.0f, 0.0f}, {0.0f, 0.0f} };
-    static float lastDirectionChangeTime[3] = { 0.0f, 0.0f, 0.0f };
-
-    for (int i = 0; i < 3; i++) {
-        float currentTime = glfwGetTime();
-
-        // Change direction every 2 seconds
-        if (currentTime - lastDirectionChangeTime[i] >= st) {
-        lastDirectionChangeTime[i] = currentTime;
-        float angle = ((rand() % 360) * 3.14159f) / 180.0f; // Random angle in radians
-        enemyMoveDirections[i][0] = cos(angle) * 0.005f; // Speed in x direction
-        enemyMoveDirections[i][1] = sin(angle) * 0.005f; // Speed in y direction
-        }
-
-        // Update enemy position
-        enemyPositions[i][0] += enemyMoveDirections[i][0];
-        enemyPositions[i][1] += enemyMoveDirections[i][1];
-
-        // Reverse direction if enemy goes offscreen
-        if (enemyPositions[i][0] < -1.0f || enemyPositions[i][0] > 1.0f) {
-        enemyMoveDirections[i][0] = -enemyMoveDirections[i][0];
-        }
-        if (enemyPositions[i][1] < -1.0f || enemyPositions[i][1] > 1.0f) {
-        enemyMoveDirections[i][1] = -enemyMoveDirections[i][1];
-        }
-    }
-    st = 2.0;
-
-        // Handle projectile logic
-        static bool spacePressed = false;
-        static float projectileX = playerX, projectileY = playerY;
-        static bool projectileActive = false;
-        static bool projact = false;
-        static bool xpres = false;
-        if(glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS){
-            std::cout << "Game Over" << std::endl <<"Enemies Killed: " << score << std::endl;
-                glfwSetWindowShouldClose(window, true); // Close the window
-                break;
-        }
-        if (!projact&&glfwGetKey(window, GLFW_KEY_Z) == GLFW_PRESS && !spacePressed) {
-            spacePressed = true;
-            if (!projectileActive) {
-            projectileX = playerX;
-            projectileY = playerY;
-            projectileActive = true;
+        };
+
+        gpuProfiler.beginFrame();
+        if (scaledRendering)
+            resolution.beginScene();
+        if (options.batched) {
+            // The background and every live entity go into one batch, each
+            // in its pass's layer; the batch sorts by layer and texture and
+            // draws each texture run of a pass in one call
+            glState.useProgram(instancedShader.id());
+            spriteBatch.begin();
+            spriteBatch.setDrawLayer(PASS_BACKGROUND);
+            spriteBatch.add(bgSource.texture, 0.0f, 0.0f, 1.0f, bgSource.region, bgSource.layer);
+            for (const SpriteInstance& sprite : sprites) {
+                SpriteSource source = spriteSource(sprite);
+                spriteBatch.setDrawLayer(spritePass(sprite.type));
+                spriteBatch.add(source.texture, sprite.x, sprite.y, SPRITE_SCALE, source.region, source.layer);
+            }
+            bool uploaded = spriteBatch.upload(glState);
+            for (uint32_t pass = 0; pass < SCENE_PASS_COUNT; pass++) {
+                gpuProfiler.beginPass(pass);
+                if (pass == PASS_BACKGROUND) {
+                    glClearColor(0.1f, 0.2f, 0.2f, 1.0f);
+                    glClear(GL_COLOR_BUFFER_BIT);
+                }
+                if (uploaded)
+                    spriteBatch.drawLayer(glState, pass);
+                gpuProfiler.endPass();
+            }
+            if (uploaded)
+                spriteBatch.finish();
+        } else {
+            // Background, then each pass's entities in turn, picking the
+            // texture from the type
+            glState.useProgram(shader.id());
+            for (uint32_t pass = 0; pass < SCENE_PASS_COUNT; pass++) {
+                gpuProfiler.beginPass(pass);
+                if (pass == PASS_BACKGROUND) {
+                    glClearColor(0.1f, 0.2f, 0.2f, 1.0f);
+                    glClear(GL_COLOR_BUFFER_BIT);
+                    drawSprite(glState, shader, offsetLocation, VAO, bgTexture, 0.0f, 0.0f);
+                }
+                for (const SpriteInstance& sprite : sprites) {
+                    if (spritePass(sprite.type) == pass)
+                        drawSprite(glState, shader, offsetLocation, playerVAO, spriteTexture(sprite), sprite.x, sprite.y);
+                }
+                gpuProfiler.endPass();
             }
         }
-        if (glfwGetKey(window, GLFW_KEY_Z) == GLFW_RELEASE) {
-            spacePressed = false;
+        times.render += secondsSince(renderStart);
+        times.samples++;
+        PROFILE_END(renderSubmission, "render submission");
+
+        if (scaledRendering) {
+            gpuProfiler.beginPass(upscalePass);
+            resolution.present();
+            gpuProfiler.endPass();
         }
-         if (!projectileActive&&glfwGetKey(window, GLFW_KEY_X) == GLFW_PRESS && !spacePressed) {
-            xpres = true;
-            if (!projact) {
-            projectileX = playerX;
-            projectileY = playerY;
-            projact = true;
-            }
+        gpuProfiler.endFrame();
+
+        // Every collected frame, including any beginFrame() read early
+        gpuProfiler.poll();
+        GpuFrameTimes gpu;
+        while (gpuProfiler.nextFrame(gpu)) {
+            if (scaledRendering)
+                resolution.reportGpuTime(gpu.totalMs);
+            for (int pass = 0; pass < gpuProfiler.passCount(); pass++)
+                overlayTimes.passMs[pass] += gpu.passMs[pass];
+            overlayTimes.totalMs += gpu.totalMs;
+            overlayFrames++;
         }
-        if (glfwGetKey(window, GLFW_KEY_X) == GLFW_RELEASE) {
-            xpres = false;
+        if (options.gpuOverlay && overlayFrames && now - lastOverlayTime >= GPU_OVERLAY_INTERVAL) {
+            std::ostringstream title;
+            title.precision(2);
+            title << std::fixed << "Mystic Brawl - GPU " << overlayTimes.totalMs / overlayFrames << " ms (";
+            for (int pass = 0; pass < gpuProfiler.passCount(); pass++)
+                title << (pass ? ", " : "") << gpuProfiler.passName(pass) << " " << overlayTimes.passMs[pass] / overlayFrames;
+            title << ")";
+            glfwSetWindowTitle(window, title.str().c_str());
+            overlayTimes = GpuFrameTimes();
+            overlayFrames = 0;
+            lastOverlayTime = now;
         }
 
-        if (projectileActive) {
-            projectileX += 0.05f; // Move projectile to the right with increased speed
-
-            // Draw projectile
-            glUniform2f(glGetUniformLocation(shader, "offset"), projectileX, projectileY);
-            glBindTexture(GL_TEXTURE_2D, bulletTexture); // Use bullet texture
-            glBindVertexArray(playerVAO); // Reusing player VAO
-            glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
-
-            // Deactivate projectile if it goes out of bounds
-            if (projectileX > 1.0f) {
-            projectileActive = false;
-            }
+        {
+            PROFILE_ZONE("glfwSwapBuffers");
+            glfwSwapBuffers(window);
+        }
+        {
+            PROFILE_ZONE("glfwPollEvents");
+            glfwPollEvents();
         }
 
-         if(projact){
-            projectileX -= 0.05f; // Move projectile to the right with increased speed
-
-            // Draw projectile
-            glUniform2f(glGetUniformLocation(shader, "offset"), projectileX, projectileY);
-            glBindTexture(GL_TEXTURE_2D, bulletTexture); // Use bullet texture
-            glBindVertexArray(playerVAO); // Reusing player VAO
-            glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+        // Zones are only recorded in MYSTIC_PROFILE builds
+        bool traceKey = glfwGetKey(window, CPU_TRACE_KEY) == GLFW_PRESS;
+        if (CPU_PROFILER_ENABLED && traceKey && !traceKeyHeld)
+            writeChromeTrace(CPU_TRACE_PATH);
+        traceKeyHeld = traceKey;
+    }
 
-            // Deactivate projectile if it goes out of bounds
-            if (projectileX < -1.0f) {
-            projact = false;
-            }
-        }
+    if (CPU_PROFILER_ENABLED)
+        writeChromeTrace(CPU_TRACE_PATH);
+
+    // Per-frame phase costs (update and collision summed over the ticks run
+    // in each frame)
+    std::cout << "Frame averages over " << times.samples << " frames:\n";
+    times.print("render submission");
+    double frames = times.samples ? (double)times.samples : 1.0;
+    std::cout << "  GL binds  " << glState.issuedCalls() / frames << " issued, "
+              << glState.skippedCalls() / frames << " redundant skipped per frame\n";
+    if (options.batched) {
+        std::cout << "  instances streamed through " << (spriteBatch.stream().persistent() ? "a persistent mapping" : "orphaned buffers")
+                  << ", " << spriteBatch.stream().stalls() << " GPU waits\n";
+    }
+    if (scaledRendering) {
+        std::cout << "  render scale " << resolution.averageScale();
+        if (resolution.fixed())
+            std::cout << " (fixed)";
+        else
+            std::cout << " average, " << resolution.scaleChanges() << " changes";
+        std::cout << ", GPU frame " << resolution.averageGpuMs() << " ms\n";
+    }
+    std::cout << "  GPU passes";
+    for (int pass = 0; pass < gpuProfiler.passCount(); pass++)
+        std::cout << (pass ? ", " : " ") << gpuProfiler.passName(pass) << " " << gpuProfiler.averageMs(pass) << " ms";
+    std::cout << " (" << gpuProfiler.frames() << " frames timed, " << gpuProfiler.dropped() << " dropped)\n";
+    if (options.gpuProfilePath) {
+        std::string path = options.gpuProfilePath;
+        bool json = path.size() >= 5 && path.compare(path.size() - 5, 5, ".json") == 0;
+        if (json ? gpuProfiler.writeJson(path) : gpuProfiler.writeCsv(path))
+            std::cout << "GPU profile written to " << path << "\n";
+    }
 
-        // Handle enemy projectiles
-        static float enemyProjectilePositions[3][2] = { {0.0f, 0.0f}, {0.0f, 0.0f}, {0.0f, 0.0f} };
-        static float enemyProjectileDirections[3][2] = { {0.0f, 0.0f}, {0.0f, 0.0f}, {0.0f, 0.0f} };
-        static bool enemyProjectileActive[3] = { false, false, false };
-        static float lastEnemyShotTime[3] = { 0.0f, 0.0f, 0.0f };
-        static unsigned int axeTexture = loadTexture("textures/attack.png");
-
-        float currentTime = glfwGetTime();
-        for (int i = 0; i < 3; i++) {
-            // Shoot a projectile every 0.75 seconds (increased frequency)
-            if (currentTime - lastEnemyShotTime[i] >= 0.75f) {
-            lastEnemyShotTime[i] = currentTime;
-            if (!enemyProjectileActive[i]) {
-                enemyProjectilePositions[i][0] = enemyPositions[i][0];
-                enemyProjectilePositions[i][1] = enemyPositions[i][1];
-                float angle = ((rand() % 360) * 3.14159f) / 180.0f; // Random angle in radians
-                enemyProjectileDirections[i][0] = cos(angle) * 0.02f; // Speed in x direction
-                enemyProjectileDirections[i][1] = sin(angle) * 0.02f; // Speed in y direction
-                enemyProjectileActive[i] = true;
-            }
-            }
+    if (options.recordPath) {
+        replay.gamesCompleted = sim.state().gameOver ? 1 : 0;
+        replay.totalScore = sim.state().score;
+        saveReplay(options.recordPath, replay);
+    }
 
-            // Update and draw active projectiles
-            if (enemyProjectileActive[i]) {
-            enemyProjectilePositions[i][0] += enemyProjectileDirections[i][0];
-            enemyProjectilePositions[i][1] += enemyProjectileDirections[i][1];
-
-            // Draw projectile with smaller size
-            glUniform2f(glGetUniformLocation(shader, "offset"), enemyProjectilePositions[i][0], enemyProjectilePositions[i][1]);
-            glBindTexture(GL_TEXTURE_2D, axeTexture);
-            glBindVertexArray(playerVAO); // Reusing player VAO
-            glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
-
-            // Deactivate projectile if it goes out of bounds
-            if (enemyProjectilePositions[i][0] < -1.0f || enemyProjectilePositions[i][0] > 1.0f ||
-                enemyProjectilePositions[i][1] < -1.0f || enemyProjectilePositions[i][1] > 1.0f) {
-                enemyProjectileActive[i] = false;
-            }
+    // The immediate-mode quads; everything else frees itself on return
+    glDeleteVertexArrays(1, &VAO);
+    glDeleteBuffers(1, &VBO);
+    glDeleteBuffers(1, &EBO);
+    glDeleteVertexArrays(1, &playerVAO);
+    glDeleteBuffers(1, &playerVBO);
+    glDeleteBuffers(1, &playerEBO);
+    return 0;
+}
 
-            // Check for collision with player
-            if (abs(enemyProjectilePositions[i][0] - playerX) < 0.03f && abs(enemyProjectilePositions[i][1] - playerY) < 0.03f) { // Smaller collision box
-                std::cout << "Game Over" << std::endl << "Enemies Killed: " << score << std::endl;
-                glfwSetWindowShouldClose(window, true); // Close the window
-                break;
+int main(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--headless") == 0) {
+            options.headless = true;
+        } else if (strcmp(argv[i], "--stress") == 0) {
+            options.stress = true;
+        } else if (strcmp(argv[i], "--bench-collision") == 0) {
+            options.benchCollision = true;
+        } else if (strcmp(argv[i], "--ticks") == 0 && i + 1 < argc) {
+            options.ticks = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--sim-hz") == 0 && i + 1 < argc) {
+            options.simHz = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            options.seed = strtoull(argv[++i], nullptr, 0);
+        } else if (strcmp(argv[i], "--enemies") == 0 && i + 1 < argc) {
+            options.enemies = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--collision-kernel") == 0 && i + 1 < argc) {
+            const char* kernel = argv[++i];
+            if (!setOverlapKernel(kernel)) {
+                std::cerr << "Collision kernel " << kernel << " is unknown or not supported on this CPU\n";
+                return -1;
             }
+        } else if (strcmp(argv[i], "--no-shader-cache") == 0) {
+            options.shaderCache = false;
+        } else if (strcmp(argv[i], "--renderer") == 0 && i + 1 < argc) {
+            const char* renderer = argv[++i];
+            if (strcmp(renderer, "batched") == 0) {
+                options.batched = true;
+            } else if (strcmp(renderer, "immediate") == 0) {
+                options.batched = false;
+            } else {
+                std::cerr << "Renderer must be batched or immediate\n";
+                return -1;
             }
-        }
-        // Check for collisions between player and enemies
-        for (int i = 0; i < 3; i++) {
-            if (abs(playerX - enemyPositions[i][0]) < 0.1f && abs(playerY - enemyPositions[i][1]) < 0.1f) {
-                std::cout << "Game Over" << std::endl <<"Enemies Killed: " << score << std::endl;
-                glfwSetWindowShouldClose(window, true); // Close the window
-                break;
+        } else if (strcmp(argv[i], "--stream-buffer") == 0 && i + 1 < argc) {
+            const char* mode = argv[++i];
+            if (strcmp(mode, "persistent") == 0) {
+                options.persistentBuffers = true;
+            } else if (strcmp(mode, "orphan") == 0) {
+                options.persistentBuffers = false;
+            } else {
+                std::cerr << "Stream buffer must be persistent or orphan\n";
+                return -1;
             }
-        }
-        // Check for collisions between projectile and enemies
-        if (projectileActive||projact) {
-            for (int i = 0; i < 3; i++) {
-            if (abs(projectileX - enemyPositions[i][0]) < 0.1f && abs(projectileY - enemyPositions[i][1]) < 0.1f) {
-                score++;
-                // Respawn enemy at a random position, ensuring it's not where the player is
-                do {
-                enemyPositions[i][0] = ((rand() % 200) - 100) / 100.0f; // Random value between -1.0 and 1.0
-                enemyPositions[i][1] = ((rand() % 200) - 100) / 100.0f; // Random value between -1.0 and 1.0
-                } while (abs(enemyPositions[i][0] - playerX) < 0.2f && abs(enemyPositions[i][1] - playerY) < 0.2f);
-                
-                projectileActive = false; // Deactivate projectile
-                break;
+        } else if (strcmp(argv[i], "--quads") == 0 && i + 1 < argc) {
+            const char* quads = argv[++i];
+            if (strcmp(quads, "vertex-id") == 0) {
+                options.vertexIdQuads = true;
+            } else if (strcmp(quads, "indexed") == 0) {
+                options.vertexIdQuads = false;
+            } else {
+                std::cerr << "Quads must be vertex-id or indexed\n";
+                return -1;
             }
+        } else if (strcmp(argv[i], "--texture-array") == 0) {
+            options.textureArray = true;
+        } else if (strcmp(argv[i], "--render-scale") == 0 && i + 1 < argc) {
+            const char* scale = argv[++i];
+            options.renderScale = strcmp(scale, "auto") == 0 ? 0.0f : (float)atof(scale);
+            if (strcmp(scale, "auto") != 0 && (options.renderScale <= 0.0f || options.renderScale > 1.0f)) {
+                std::cerr << "Render scale must be auto or between 0 and 1\n";
+                return -1;
             }
+        } else if (strcmp(argv[i], "--gpu-budget-ms") == 0 && i + 1 < argc) {
+            options.gpuBudgetMs = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--gpu-profile") == 0 && i + 1 < argc) {
+            options.gpuProfilePath = argv[++i];
+        } else if (strcmp(argv[i], "--gpu-overlay") == 0) {
+            options.gpuOverlay = true;
+        } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            options.recordPath = argv[++i];
+        } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            options.replayPath = argv[++i];
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--sim-hz N] [--seed N] [--enemies N] [--collision-kernel scalar|sse2|avx2] [--renderer batched|immediate] [--stream-buffer persistent|orphan] [--quads vertex-id|indexed] [--texture-array] [--render-scale auto|F] [--gpu-budget-ms MS] [--gpu-profile FILE] [--gpu-overlay] [--no-shader-cache] [--record FILE] [--headless [--ticks N]]\n"
+                      << "       " << argv[0] << " --replay FILE\n"
+                      << "       " << argv[0] << " --stress [--ticks N]\n"
+                      << "       " << argv[0] << " --bench-collision\n";
+            return -1;
         }
-        glfwSwapBuffers(window);
-        glfwPollEvents();
     }
-
+    if (options.simHz <= 0 || options.simHz > 0xFFFF) {
+        std::cerr << "--sim-hz must be between 1 and 65535\n";
+        return -1;
+    }
+    if (options.enemies < 0) {
+        std::cerr << "--enemies must not be negative\n";
+        return -1;
+    }
+    if (options.replayPath)
+        return runReplay(options.replayPath);
+    if (options.stress)
+        return runStress(options);
+    if (options.benchCollision)
+        return runCollisionBenchmark(options.seed);
+    if (options.headless)
+        return runHeadless(options);
+
+    int result = runWindowed(options);
     glfwTerminate();
-    return 0;
+    return result;
 }
@@ -0,0 +1,119 @@
+#include "program_cache.h"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <vector>
+
+namespace {
+
+const char BINARY_MAGIC[4] = { 'M', 'B', 'P', 'B' };
+
+// FNV-1a, continued from hash
+uint64_t hashString(uint64_t hash, const char* text) {
+    for (const char* c = text; *c; c++) {
+        hash ^= (unsigned char)*c;
+        hash *= 0x100000001b3ull;
+    }
+    // Separator, so "ab" + "c" and "a" + "bc" differ
+    hash ^= 0xFF;
+    hash *= 0x100000001b3ull;
+    return hash;
+}
+
+void put32(std::vector<unsigned char>& out, uint32_t value) {
+    for (int i = 0; i < 4; i++)
+        out.push_back((unsigned char)(value >> (8 * i)));
+}
+
+uint32_t get32(const unsigned char* in) {
+    return in[0] | (in[1] << 8) | (in[2] << 16) | ((uint32_t)in[3] << 24);
+}
+
+}
+
+bool ProgramBinaryCache::init() {
+    enabled_ = false;
+    if (!GLAD_GL_VERSION_4_1 || !glGetProgramBinary || !glProgramBinary || !glProgramParameteri)
+        return false;
+    int formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    if (formats <= 0)
+        return false;
+
+    std::error_code error;
+    std::filesystem::create_directories(directory_, error);
+    if (error) {
+        std::cerr << "Shader cache disabled, cannot create " << directory_ << ": " << error.message() << "\n";
+        return false;
+    }
+
+    driver_ = std::string((const char*)glGetString(GL_VENDOR)) + "|" + (const char*)glGetString(GL_RENDERER) +
+              "|" + (const char*)glGetString(GL_VERSION);
+    enabled_ = true;
+    return true;
+}
+
+std::string ProgramBinaryCache::pathFor(const char* vertexSource, const char* fragmentSource) const {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    hash = hashString(hash, driver_.c_str());
+    hash = hashString(hash, vertexSource);
+    hash = hashString(hash, fragmentSource);
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)hash);
+    return directory_ + "/" + name;
+}
+
+unsigned int ProgramBinaryCache::load(const char* vertexSource, const char* fragmentSource) {
+    if (!enabled_)
+        return 0;
+    std::ifstream file(pathFor(vertexSource, fragmentSource), std::ios::binary);
+    std::vector<unsigned char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    // magic, u32 format, u32 length, binary
+    if (data.size() < 12 || !std::equal(BINARY_MAGIC, BINARY_MAGIC + 4, data.begin()) ||
+        get32(&data[8]) != data.size() - 12) {
+        misses_++;
+        return 0;
+    }
+
+    unsigned int program = glCreateProgram();
+    glProgramBinary(program, get32(&data[4]), &data[12], (GLsizei)(data.size() - 12));
+    int ok = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &ok);
+    if (!ok) {
+        // The driver may reject binaries from another build of itself; the
+        // caller recompiles and the entry is overwritten
+        glDeleteProgram(program);
+        misses_++;
+        return 0;
+    }
+    hits_++;
+    return program;
+}
+
+void ProgramBinaryCache::store(unsigned int program, const char* vertexSource, const char* fragmentSource) {
+    if (!enabled_)
+        return;
+    int length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return;
+
+    std::vector<unsigned char> data(BINARY_MAGIC, BINARY_MAGIC + 4);
+    std::vector<unsigned char> binary(length);
+    GLenum format = 0;
+    glGetProgramBinary(program, length, &length, &format, binary.data());
+    put32(data, format);
+    put32(data, (uint32_t)length);
+    data.insert(data.end(), binary.begin(), binary.begin() + length);
+
+    std::string path = pathFor(vertexSource, fragmentSource);
+    std::ofstream file(path, std::ios::binary);
+    if (!file.write((const char*)data.data(), data.size()))
+        std::cerr << "Failed to write shader cache entry: " << path << "\n";
+}
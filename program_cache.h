@@ -0,0 +1,41 @@
+#pragma once
+
+// On-disk cache of linked shader programs (glGetProgramBinary /
+// glProgramBinary). Entries are keyed by a hash of the shader sources and
+// the driver's vendor, renderer and version strings, so a driver update or a
+// shader edit simply misses and the program is compiled from source again.
+//
+// Program binaries need GL 4.1; on older contexts, or when the driver
+// exposes no binary formats, the cache stays disabled and every program is
+// compiled from source.
+
+#include <cstdint>
+#include <string>
+#include <utility>
+
+class ProgramBinaryCache {
+public:
+    explicit ProgramBinaryCache(std::string directory) : directory_(std::move(directory)) {}
+
+    // Needs a current GL context. Returns whether binaries are supported.
+    bool init();
+    bool enabled() const { return enabled_; }
+
+    // A linked program loaded from the cache, or 0 on a miss or if the
+    // driver rejects the stored binary
+    unsigned int load(const char* vertexSource, const char* fragmentSource);
+    // Save a program linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT set
+    void store(unsigned int program, const char* vertexSource, const char* fragmentSource);
+
+    int hits() const { return hits_; }
+    int misses() const { return misses_; }
+
+private:
+    std::string pathFor(const char* vertexSource, const char* fragmentSource) const;
+
+    std::string directory_;
+    std::string driver_; // vendor, renderer and version, part of every key
+    bool enabled_ = false;
+    int hits_ = 0;
+    int misses_ = 0;
+};
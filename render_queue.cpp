@@ -0,0 +1,54 @@
+#include "render_queue.h"
+
+#include <cstring>
+#include <utility>
+
+void RenderQueue::sort() {
+    const size_t n = keys_.size();
+    if (n < 2)
+        return;
+
+    // All eight byte histograms in one read of the keys
+    uint32_t counts[8][256];
+    memset(counts, 0, sizeof(counts));
+    for (size_t i = 0; i < n; i++) {
+        uint64_t key = keys_[i];
+        for (int pass = 0; pass < 8; pass++)
+            counts[pass][(key >> (8 * pass)) & 0xFF]++;
+    }
+
+    scratchKeys_.resize(n);
+    scratchItems_.resize(n);
+    uint64_t* keys = keys_.data();
+    uint32_t* items = items_.data();
+    uint64_t* outKeys = scratchKeys_.data();
+    uint32_t* outItems = scratchItems_.data();
+
+    for (int pass = 0; pass < 8; pass++) {
+        const int shift = 8 * pass;
+        // A byte every key shares cannot change the order; most fields are
+        // narrow in practice, so most passes are skipped
+        if (counts[pass][(keys[0] >> shift) & 0xFF] == n)
+            continue;
+
+        uint32_t offsets[256];
+        uint32_t total = 0;
+        for (int b = 0; b < 256; b++) {
+            offsets[b] = total;
+            total += counts[pass][b];
+        }
+        for (size_t i = 0; i < n; i++) {
+            uint32_t slot = offsets[(keys[i] >> shift) & 0xFF]++;
+            outKeys[slot] = keys[i];
+            outItems[slot] = items[i];
+        }
+        std::swap(keys, outKeys);
+        std::swap(items, outItems);
+    }
+
+    // An odd number of passes leaves the result in the scratch buffers
+    if (keys != keys_.data()) {
+        keys_.swap(scratchKeys_);
+        items_.swap(scratchItems_);
+    }
+}
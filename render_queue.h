@@ -0,0 +1,45 @@
+#pragma once
+
+// Per-frame list of draws ordered by packed 64-bit sort keys.
+//
+// Key layout, most significant first:
+//   8 bits  layer    (background, sprites, overlays, ...)
+//   8 bits  program  (index chosen by the caller)
+//   16 bits texture  (index chosen by the caller)
+//   32 bits depth    (back to front within the rest)
+// Sorting puts everything that shares a prefix next to each other, so
+// submission only changes state where the prefix changes. sort() is a
+// stable LSD radix sort, so equal keys keep the order they were pushed in.
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+inline uint64_t makeRenderKey(uint32_t layer, uint32_t program, uint32_t texture, uint32_t depth) {
+    return ((uint64_t)(layer & 0xFF) << 56) | ((uint64_t)(program & 0xFF) << 48) |
+           ((uint64_t)(texture & 0xFFFF) << 32) | depth;
+}
+
+inline uint32_t renderKeyLayer(uint64_t key) { return (uint32_t)(key >> 56); }
+inline uint32_t renderKeyProgram(uint64_t key) { return (uint32_t)(key >> 48) & 0xFF; }
+inline uint32_t renderKeyTexture(uint64_t key) { return (uint32_t)(key >> 32) & 0xFFFF; }
+
+class RenderQueue {
+public:
+    void clear() { keys_.clear(); items_.clear(); }
+    // item is the caller's handle for the draw, e.g. an index into its data
+    void push(uint64_t key, uint32_t item) { keys_.push_back(key); items_.push_back(item); }
+
+    void sort();
+
+    size_t size() const { return keys_.size(); }
+    uint64_t key(size_t i) const { return keys_[i]; }
+    uint32_t item(size_t i) const { return items_[i]; }
+
+private:
+    std::vector<uint64_t> keys_;
+    std::vector<uint32_t> items_;
+    // Ping-pong buffers for the radix passes
+    std::vector<uint64_t> scratchKeys_;
+    std::vector<uint32_t> scratchItems_;
+};
@@ -0,0 +1,38 @@
+#pragma once
+
+// Recorded input for deterministic replays.
+//
+// A replay is the seed, the tick rate and the key bitmask for every tick.
+// Since the simulation is deterministic, that is enough to reproduce a game
+// exactly, which makes replays a repeatable workload for profiling and
+// regression runs.
+//
+// File layout (little-endian, version 3):
+//   char[4] magic "MBRP"
+//   u16     version
+//   u16     simHz
+//   u64     seed
+//   u32     enemy count            (version 2+)
+//   u32     tick count
+//   u32     games completed during the recording
+//   u32     total score at the end of the recording
+//   u32     run count
+//   runs:   u16 keys, u16 length   (run-length encoded ticks)
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct Replay {
+    uint16_t simHz = 0;
+    uint64_t seed = 0;
+    uint32_t enemyCount = 3;
+    std::vector<uint16_t> ticks;
+
+    // Outcome at the end of the recording, checked again on playback
+    uint32_t gamesCompleted = 0;
+    uint32_t totalScore = 0;
+};
+
+bool saveReplay(const std::string& path, const Replay& replay);
+bool loadReplay(const std::string& path, Replay& replay);
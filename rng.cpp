@@ -0,0 +1,80 @@
+#include "rng.h"
+
+#include <cmath>
+
+namespace {
+
+// Directions for each whole degree, matching the old rand() % 360 angles
+struct DirectionTable {
+    float x[360], y[360];
+
+    DirectionTable() {
+        for (int i = 0; i < 360; i++) {
+            float angle = (i * 3.14159f) / 180.0f;
+            x[i] = std::cos(angle);
+            y[i] = std::sin(angle);
+        }
+    }
+};
+
+const DirectionTable& directionTable() {
+    static const DirectionTable table;
+    return table;
+}
+
+// Entities per vector pass: a multiple of any vector width, and small enough
+// that few entities are left over for the scalar tail
+const int DRAW_BLOCK = 8;
+
+// Word 0 of randomDraw() for each lane, reduced to a degree. The lanes share
+// the key schedule, so each round is one straight-line loop over arrays.
+void drawDegrees(uint64_t seed, const uint32_t* streams, const uint64_t* indices, uint32_t* degrees) {
+    uint32_t c0[DRAW_BLOCK], c1[DRAW_BLOCK], c2[DRAW_BLOCK], c3[DRAW_BLOCK];
+    for (int i = 0; i < DRAW_BLOCK; i++) {
+        c0[i] = (uint32_t)indices[i];
+        c1[i] = (uint32_t)(indices[i] >> 32);
+        c2[i] = streams[i];
+        c3[i] = 0;
+    }
+    uint32_t k0 = (uint32_t)seed, k1 = (uint32_t)(seed >> 32);
+    for (int round = 0; round < 10; round++) {
+        for (int i = 0; i < DRAW_BLOCK; i++) {
+            uint64_t p0 = (uint64_t)0xD2511F53u * c0[i];
+            uint64_t p1 = (uint64_t)0xCD9E8D57u * c2[i];
+            uint32_t x0 = (uint32_t)(p1 >> 32) ^ c1[i] ^ k0;
+            uint32_t x2 = (uint32_t)(p0 >> 32) ^ c3[i] ^ k1;
+            c1[i] = (uint32_t)p1;
+            c3[i] = (uint32_t)p0;
+            c0[i] = x0;
+            c2[i] = x2;
+        }
+        k0 += 0x9E3779B9u;
+        k1 += 0xBB67AE85u;
+    }
+    for (int i = 0; i < DRAW_BLOCK; i++)
+        degrees[i] = randomBelow(c0[i], 360);
+}
+
+}
+
+void randomDirectionBatch(uint64_t seed, const uint32_t* streams, uint64_t* indices,
+                          int count, float speed, float* dx, float* dy) {
+    const DirectionTable& table = directionTable();
+    uint32_t degrees[DRAW_BLOCK];
+    int i = 0;
+    for (; i + DRAW_BLOCK <= count; i += DRAW_BLOCK) {
+        drawDegrees(seed, streams + i, indices + i, degrees);
+        for (int j = 0; j < DRAW_BLOCK; j++) {
+            indices[i + j]++;
+            dx[i + j] = table.x[degrees[j]] * speed;
+            dy[i + j] = table.y[degrees[j]] * speed;
+        }
+    }
+    // The last few, and single draws, are cheaper one at a time
+    for (; i < count; i++) {
+        uint32_t degree = randomBelow(randomDraw(seed, streams[i], indices[i]).v[0], 360);
+        indices[i]++;
+        dx[i] = table.x[degree] * speed;
+        dy[i] = table.y[degree] * speed;
+    }
+}
@@ -0,0 +1,168 @@
+#include "shader.h"
+
+#include <glad/glad.h>
+
+#include <cstring>
+#include <iostream>
+
+#include "program_cache.h"
+
+namespace {
+
+// Print the info log of a stage that failed to compile; true if it compiled
+bool checkStage(unsigned int shader, const char* stage) {
+    int ok = 0;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &ok);
+    if (!ok) {
+        char log[1024];
+        glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+        std::cerr << stage << " shader failed to compile:\n" << log << "\n";
+    }
+    return ok != 0;
+}
+
+}
+
+bool ShaderProgram::build(const char* vertexSource, const char* fragmentSource, ProgramBinaryCache* cache) {
+    beginBuild(vertexSource, fragmentSource, cache);
+    return finishBuild();
+}
+
+void ShaderProgram::beginBuild(const char* vertexSource, const char* fragmentSource, ProgramBinaryCache* cache) {
+    pending_ = Pending();
+    pending_.cache = cache;
+    if (cache) {
+        if (unsigned int program = cache->load(vertexSource, fragmentSource)) {
+            pending_.program = program;
+            pending_.fromCache = true;
+            return;
+        }
+    }
+    pending_.vertexSource = vertexSource;
+    pending_.fragmentSource = fragmentSource;
+
+    // No status queries here: each one would wait for the compiler
+    pending_.vertexShader = glCreateShader(GL_VERTEX_SHADER);
+    glShaderSource(pending_.vertexShader, 1, &vertexSource, nullptr);
+    glCompileShader(pending_.vertexShader);
+    pending_.fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+    glShaderSource(pending_.fragmentShader, 1, &fragmentSource, nullptr);
+    glCompileShader(pending_.fragmentShader);
+
+    pending_.program = glCreateProgram();
+    if (cache && cache->enabled())
+        glProgramParameteri(pending_.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glAttachShader(pending_.program, pending_.vertexShader);
+    glAttachShader(pending_.program, pending_.fragmentShader);
+    glLinkProgram(pending_.program);
+}
+
+ShaderProgram::~ShaderProgram() {
+    // A build begun but never finished still owns its objects
+    if (pending_.program && !pending_.fromCache) {
+        glDeleteShader(pending_.vertexShader);
+        glDeleteShader(pending_.fragmentShader);
+    }
+    if (pending_.program)
+        glDeleteProgram(pending_.program);
+    if (program_)
+        glDeleteProgram(program_);
+}
+
+bool ShaderProgram::finishBuild() {
+    Pending pending = pending_;
+    pending_ = Pending();
+    if (!pending.program)
+        return false;
+
+    bool ok = pending.fromCache;
+    if (!ok) {
+        int linked = 0;
+        glGetProgramiv(pending.program, GL_LINK_STATUS, &linked);
+        ok = linked != 0;
+        if (!ok) {
+            // A stage that failed to compile explains the link failure better
+            if (checkStage(pending.vertexShader, "Vertex") && checkStage(pending.fragmentShader, "Fragment")) {
+                char log[1024];
+                glGetProgramInfoLog(pending.program, sizeof(log), nullptr, log);
+                std::cerr << "Shader program failed to link:\n" << log << "\n";
+            }
+        }
+        glDeleteShader(pending.vertexShader);
+        glDeleteShader(pending.fragmentShader);
+    }
+    if (!ok) {
+        glDeleteProgram(pending.program);
+        return false;
+    }
+
+    if (program_)
+        glDeleteProgram(program_);
+    program_ = pending.program;
+    resolveLocations();
+    if (pending.cache && !pending.fromCache)
+        pending.cache->store(program_, pending.vertexSource.c_str(), pending.fragmentSource.c_str());
+    return true;
+}
+
+void ShaderProgram::resolveLocations() {
+    uniforms_.clear();
+    attributes_.clear();
+    char name[256];
+    int count = 0;
+    glGetProgramiv(program_, GL_ACTIVE_UNIFORMS, &count);
+    for (int i = 0; i < count; i++) {
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(program_, (GLuint)i, sizeof(name), &length, &size, &type, name);
+        // Arrays are reported as "name[0]"; cache them under the bare name
+        if (char* bracket = strchr(name, '['))
+            *bracket = '\0';
+        uniforms_.push_back({ name, glGetUniformLocation(program_, name) });
+    }
+    glGetProgramiv(program_, GL_ACTIVE_ATTRIBUTES, &count);
+    for (int i = 0; i < count; i++) {
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveAttrib(program_, (GLuint)i, sizeof(name), &length, &size, &type, name);
+        attributes_.push_back({ name, glGetAttribLocation(program_, name) });
+    }
+}
+
+void ShaderProgram::use() const {
+    glUseProgram(program_);
+}
+
+int ShaderProgram::find(const std::vector<Location>& table, const char* name) {
+    for (const Location& entry : table) {
+        if (entry.name == name)
+            return entry.location;
+    }
+    return -1;
+}
+
+int ShaderProgram::uniform(const char* name) const {
+    return find(uniforms_, name);
+}
+
+int ShaderProgram::attribute(const char* name) const {
+    return find(attributes_, name);
+}
+
+void ShaderProgram::setInt(int location, int value) const {
+    glUniform1i(location, value);
+}
+
+void ShaderProgram::setFloat(int location, float value) const {
+    glUniform1f(location, value);
+}
+
+void ShaderProgram::setVec2(int location, float x, float y) const {
+    glUniform2f(location, x, y);
+}
+
+void ShaderProgram::setVec4(int location, float x, float y, float z, float w) const {
+    glUniform4f(location, x, y, z, w);
+}
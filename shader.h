@@ -0,0 +1,69 @@
+#pragma once
+
+// Linked GL program with its uniform and attribute locations resolved once,
+// right after linking, so draw code never calls glGetUniformLocation.
+
+#include <string>
+#include <vector>
+
+class ProgramBinaryCache;
+
+class ShaderProgram {
+public:
+    ShaderProgram() = default;
+    ~ShaderProgram();
+    ShaderProgram(const ShaderProgram&) = delete;
+    ShaderProgram& operator=(const ShaderProgram&) = delete;
+
+    // Compile and link; prints the info log and returns false on failure.
+    // With a cache, a stored binary of the same sources is used instead and
+    // freshly linked programs are stored. Needs a current GL context.
+    bool build(const char* vertexSource, const char* fragmentSource, ProgramBinaryCache* cache = nullptr);
+
+    // build() in two halves. beginBuild() only issues the compile and link,
+    // so a driver with background compiler threads can work on several
+    // programs at once; finishBuild() waits for the result and checks it.
+    void beginBuild(const char* vertexSource, const char* fragmentSource, ProgramBinaryCache* cache = nullptr);
+    bool finishBuild();
+    // The program being built, for GL_COMPLETION_STATUS_KHR polling
+    unsigned int pendingProgram() const { return pending_.program; }
+
+    unsigned int id() const { return program_; }
+    void use() const;
+
+    // Cached locations, -1 if the name is not an active uniform/attribute.
+    // Look these up at setup time and keep the result.
+    int uniform(const char* name) const;
+    int attribute(const char* name) const;
+
+    // Typed setters for the currently used program; -1 is ignored like GL does
+    void setInt(int location, int value) const;
+    void setFloat(int location, float value) const;
+    void setVec2(int location, float x, float y) const;
+    void setVec4(int location, float x, float y, float z, float w) const;
+
+private:
+    struct Location {
+        std::string name;
+        int location;
+    };
+
+    void resolveLocations();
+    static int find(const std::vector<Location>& table, const char* name);
+
+    // Between beginBuild() and finishBuild()
+    struct Pending {
+        unsigned int program = 0;
+        unsigned int vertexShader = 0;
+        unsigned int fragmentShader = 0;
+        bool fromCache = false;
+        ProgramBinaryCache* cache = nullptr;
+        std::string vertexSource;
+        std::string fragmentSource;
+    };
+
+    unsigned int program_ = 0;
+    Pending pending_;
+    std::vector<Location> uniforms_;
+    std::vector<Location> attributes_;
+};
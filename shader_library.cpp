@@ -0,0 +1,111 @@
+#include "shader_library.h"
+
+#include <glad/glad.h>
+
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <thread>
+
+// From GL_KHR_parallel_shader_compile, which this loader does not include
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+namespace {
+
+bool readFile(const std::string& path, std::string& out) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        std::cerr << "Failed to open shader: " << path << "\n";
+        return false;
+    }
+    out.assign((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    return true;
+}
+
+const struct { uint32_t flag; const char* define; } VARIANT_DEFINES[] = {
+    { SHADER_INSTANCED, "INSTANCED" },
+    { SHADER_ATLAS, "ATLAS" },
+    { SHADER_VERTEX_ID, "VERTEX_ID" },
+    { SHADER_TEXTURE_ARRAY, "TEXTURE_ARRAY" }
+};
+
+}
+
+bool ShaderLibrary::load(const std::string& vertexPath, const std::string& fragmentPath) {
+    return readFile(vertexPath, vertexSource_) && readFile(fragmentPath, fragmentSource_);
+}
+
+bool ShaderLibrary::validVariant(uint32_t variant) {
+    // gl_VertexID quads and array layers come from instance attributes, and
+    // array layers replace atlas regions
+    if ((variant & (SHADER_VERTEX_ID | SHADER_TEXTURE_ARRAY)) && !(variant & SHADER_INSTANCED))
+        return false;
+    return !((variant & SHADER_TEXTURE_ARRAY) && (variant & SHADER_ATLAS));
+}
+
+int ShaderLibrary::validVariantCount() {
+    int count = 0;
+    for (uint32_t v = 0; v < SHADER_VARIANT_COUNT; v++)
+        count += validVariant(v);
+    return count;
+}
+
+std::string ShaderLibrary::variantSource(const std::string& source, uint32_t variant) {
+    // #version has to stay the first line
+    size_t lineEnd = source.find('\n');
+    size_t split = lineEnd == std::string::npos ? source.size() : lineEnd + 1;
+    std::string defines;
+    for (const auto& d : VARIANT_DEFINES) {
+        if (variant & d.flag)
+            defines += std::string("#define ") + d.define + "\n";
+    }
+    return source.substr(0, split) + (lineEnd == std::string::npos ? "\n" : "") + defines + source.substr(split);
+}
+
+bool ShaderLibrary::buildAll(ProgramBinaryCache* cache, bool parallel) {
+    for (uint32_t v = 0; v < SHADER_VARIANT_COUNT; v++) {
+        if (!validVariant(v))
+            continue;
+        std::string vertex = variantSource(vertexSource_, v);
+        std::string fragment = variantSource(fragmentSource_, v);
+        programs_[v].beginBuild(vertex.c_str(), fragment.c_str(), cache);
+    }
+
+    if (parallel) {
+        // Finish in whatever order the compiler threads complete
+        bool finished[SHADER_VARIANT_COUNT] = {};
+        uint32_t remaining = 0;
+        for (uint32_t v = 0; v < SHADER_VARIANT_COUNT; v++) {
+            finished[v] = !validVariant(v);
+            remaining += !finished[v];
+        }
+        bool ok = true;
+        while (remaining > 0) {
+            for (uint32_t v = 0; v < SHADER_VARIANT_COUNT; v++) {
+                if (finished[v])
+                    continue;
+                int done = 1;
+                if (programs_[v].pendingProgram())
+                    glGetProgramiv(programs_[v].pendingProgram(), GL_COMPLETION_STATUS_KHR, &done);
+                if (done) {
+                    ok = programs_[v].finishBuild() && ok;
+                    finished[v] = true;
+                    remaining--;
+                }
+            }
+            // Leave the core to the compiler threads between polls
+            if (remaining > 0)
+                std::this_thread::yield();
+        }
+        return ok;
+    }
+
+    bool ok = true;
+    for (uint32_t v = 0; v < SHADER_VARIANT_COUNT; v++) {
+        if (validVariant(v))
+            ok = programs_[v].finishBuild() && ok;
+    }
+    return ok;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+// Every variant of the sprite shader (background.vs / background.fs), built
+// once at startup so nothing compiles mid-frame.
+//
+// A variant is a set of ShaderVariant flags; each set flag becomes a
+// #define inserted after the #version line of both stages.
+
+#include <cstdint>
+#include <string>
+
+#include "shader.h"
+
+class ProgramBinaryCache;
+
+enum ShaderVariant : uint32_t {
+    SHADER_INSTANCED  = 1u << 0, // per-instance offset, scale and UV rect
+    SHADER_ATLAS      = 1u << 1, // remap texture coordinates into a region
+    SHADER_VERTEX_ID  = 1u << 2, // quad from gl_VertexID; needs SHADER_INSTANCED
+    SHADER_TEXTURE_ARRAY = 1u << 3, // per-instance layer of a 2D array; needs SHADER_INSTANCED
+    SHADER_VARIANT_COUNT = 1u << 4
+};
+
+class ShaderLibrary {
+public:
+    // Read both stages; prints an error and returns false if one is missing
+    bool load(const std::string& vertexPath, const std::string& fragmentPath);
+
+    // Compile and link every variant, issuing all of them before waiting on
+    // any. With parallel set (GL_KHR_parallel_shader_compile is enabled) it
+    // polls GL_COMPLETION_STATUS_KHR instead of blocking on each program.
+    bool buildAll(ProgramBinaryCache* cache, bool parallel);
+
+    const ShaderProgram& get(uint32_t variant) const { return programs_[variant]; }
+
+    // Combinations that make sense; only these are built
+    static bool validVariant(uint32_t variant);
+    static int validVariantCount();
+
+    // source with the defines for variant inserted after its #version line
+    static std::string variantSource(const std::string& source, uint32_t variant);
+
+private:
+    std::string vertexSource_;
+    std::string fragmentSource_;
+    ShaderProgram programs_[SHADER_VARIANT_COUNT];
+};
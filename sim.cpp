@@ -0,0 +1,330 @@
+#include "sim.h"
+
+#include <cmath>
+#include <cstring>
+
+#include "cpu_profiler.h"
+#include "rng.h"
+
+// Speeds are in screen units per second (the old per-frame values at 60 Hz)
+const float PLAYER_SPEED = 0.6f;
+const float PROJECTILE_SPEED = 3.0f;
+const float ENEMY_SPEED = 0.3f;
+const float ENEMY_PROJECTILE_SPEED = 1.2f;
+
+SimState::SimState(int enemyCount, uint64_t seed)
+    : seed(seed), enemyCount(enemyCount), entities(FIRST_ENEMY + 2 * enemyCount) {
+    // The original three enemies keep their hand-placed spots
+    static const float enemyStart[DEFAULT_ENEMY_COUNT][2] = {
+        { 0.3f,  0.3f },
+        { -0.5f, -0.2f },
+        { 0.7f, -0.5f }
+    };
+
+    EntityStore& e = entities;
+    e.type[ENTITY_PLAYER1] = ENTITY_PLAYER;
+    e.alive[ENTITY_PLAYER1] = 1;
+    e.type[ENTITY_PLAYER2] = ENTITY_PLAYER;
+    e.alive[ENTITY_PLAYER2] = 1;
+    e.x[ENTITY_PLAYER2] = 0.5f;
+    e.y[ENTITY_PLAYER2] = 0.5f;
+    e.type[ENTITY_PLAYER1_PROJECTILE] = ENTITY_PLAYER_PROJECTILE;
+    e.type[ENTITY_PLAYER2_PROJECTILE] = ENTITY_PLAYER_PROJECTILE;
+
+    for (int i = 0; i < enemyCount; i++) {
+        int n = enemy(i);
+        e.type[n] = ENTITY_ENEMY;
+        e.alive[n] = 1;
+        // Each enemy draws from its own random stream
+        e.randomStream[n] = i;
+        if (i < DEFAULT_ENEMY_COUNT) {
+            e.x[n] = enemyStart[i][0];
+            e.y[n] = enemyStart[i][1];
+        } else {
+            RandomDraw r = randomDraw(seed, i, e.randomIndex[n]++);
+            e.x[n] = ((int)randomBelow(r.v[0], 200) - 100) / 100.0f;
+            e.y[n] = ((int)randomBelow(r.v[1], 200) - 100) / 100.0f;
+        }
+
+        e.type[enemyProjectile(i)] = ENTITY_ENEMY_PROJECTILE;
+    }
+}
+
+void Simulation::update(const SimInput& input) {
+    previous_.enemyCount = state_.enemyCount;
+    previous_.entities.copyHotFrom(state_.entities);
+    memset(state_.entities.teleported, 0, state_.entities.size());
+    state_.tick++;
+
+    movePlayers(input);
+    updatePlayer2Attacks(input);
+    updateEnemies();
+    updatePlayerAttacks(input);
+    updateEnemyProjectiles();
+}
+
+void Simulation::movePlayers(const SimInput& input) {
+    PROFILE_ZONE("player movement");
+    EntityStore& e = state_.entities;
+    const float speed = PLAYER_SPEED * tickSeconds_;
+    float& playerX = e.x[ENTITY_PLAYER1];
+    float& playerY = e.y[ENTITY_PLAYER1];
+    float& player2X = e.x[ENTITY_PLAYER2];
+    float& player2Y = e.y[ENTITY_PLAYER2];
+
+    // WASD is not clamped to the screen, the arrow keys are
+    if (input.held(INPUT_P1_W))
+        playerY += speed;
+    if (input.held(INPUT_P1_S))
+        playerY -= speed;
+    if (input.held(INPUT_P1_A))
+        playerX -= speed;
+    if (input.held(INPUT_P1_D))
+        playerX += speed;
+
+    if (input.held(INPUT_P1_UP) && playerY + 0.1f < 1.0f)
+        playerY += speed;
+    if (input.held(INPUT_P1_DOWN) && playerY - 0.1f > -1.0f)
+        playerY -= speed;
+    if (input.held(INPUT_P1_LEFT) && playerX - 0.1f > -1.0f)
+        playerX -= speed;
+    if (input.held(INPUT_P1_RIGHT) && playerX + 0.1f < 1.0f)
+        playerX += speed;
+
+    if (input.held(INPUT_P2_UP) && player2Y + 0.1f < 1.0f)
+        player2Y += speed;
+    if (input.held(INPUT_P2_DOWN) && player2Y - 0.1f > -1.0f)
+        player2Y -= speed;
+    if (input.held(INPUT_P2_LEFT) && player2X - 0.1f > -1.0f)
+        player2X -= speed;
+    if (input.held(INPUT_P2_RIGHT) && player2X + 0.1f < 1.0f)
+        player2X += speed;
+}
+
+void Simulation::updatePlayer2Attacks(const SimInput& input) {
+    PROFILE_ZONE("player attacks");
+    SimState& s = state_;
+    EntityStore& e = s.entities;
+    const int p = ENTITY_PLAYER2_PROJECTILE;
+
+    // Left attack (P) and right attack (O) share one projectile
+    if (!e.alive[p] && input.held(INPUT_P2_FIRE_LEFT) && !s.player2LeftHeld) {
+        s.player2LeftHeld = true;
+        e.x[p] = e.x[ENTITY_PLAYER2];
+        e.y[p] = e.y[ENTITY_PLAYER2];
+        e.vx[p] = -PROJECTILE_SPEED;
+        e.alive[p] = 1;
+        e.teleported[p] = 1;
+    }
+    if (!input.held(INPUT_P2_FIRE_LEFT)) {
+        s.player2LeftHeld = false;
+    }
+
+    if (e.alive[p] && e.vx[p] < 0.0f) {
+        e.x[p] += e.vx[p] * tickSeconds_;
+        if (e.x[p] < -1.0f) {
+            e.alive[p] = 0;
+        }
+    }
+
+    if (!e.alive[p] && input.held(INPUT_P2_FIRE_RIGHT) && !s.player2RightHeld) {
+        s.player2RightHeld = true;
+        e.x[p] = e.x[ENTITY_PLAYER2];
+        e.y[p] = e.y[ENTITY_PLAYER2];
+        e.vx[p] = PROJECTILE_SPEED;
+        e.alive[p] = 1;
+        e.teleported[p] = 1;
+    }
+    if (!input.held(INPUT_P2_FIRE_RIGHT)) {
+        s.player2RightHeld = false;
+    }
+
+    if (e.alive[p] && e.vx[p] > 0.0f) {
+        e.x[p] += e.vx[p] * tickSeconds_;
+        if (e.x[p] > 1.0f) {
+            e.alive[p] = 0;
+        }
+    }
+}
+
+void Simulation::updateEnemies() {
+    PROFILE_ZONE("enemy AI");
+    SimState& s = state_;
+    EntityStore& e = s.entities;
+    const int first = s.enemy(0);
+    const int last = first + s.enemyCount;
+
+    // Pick a new direction on the first step and every 2 seconds after.
+    // Enemies that are due are gathered so their directions come from one
+    // batched draw over their own streams.
+    dueEnemies_.clear();
+    dueStreams_.clear();
+    dueIndices_.clear();
+    for (int n = first; n < last; n++) {
+        if (!s.directionsInitialized || s.tick - e.lastDirectionChangeTick[n] >= directionIntervalTicks_) {
+            e.lastDirectionChangeTick[n] = s.tick;
+            dueEnemies_.push_back(n);
+            dueStreams_.push_back(e.randomStream[n]);
+            dueIndices_.push_back(e.randomIndex[n]);
+        }
+    }
+    int dueCount = (int)dueEnemies_.size();
+    dueX_.resize(dueCount);
+    dueY_.resize(dueCount);
+    randomDirectionBatch(s.seed, dueStreams_.data(), dueIndices_.data(), dueCount, ENEMY_SPEED, dueX_.data(), dueY_.data());
+    for (int j = 0; j < dueCount; j++) {
+        int n = dueEnemies_[j];
+        e.randomIndex[n] = dueIndices_[j];
+        e.vx[n] = dueX_[j];
+        e.vy[n] = dueY_[j];
+    }
+    s.directionsInitialized = true;
+
+    // Move, and reverse direction if an enemy goes offscreen
+    const float dt = tickSeconds_;
+    float* x = e.x;
+    float* y = e.y;
+    float* vx = e.vx;
+    float* vy = e.vy;
+    for (int n = first; n < last; n++) {
+        x[n] += vx[n] * dt;
+        y[n] += vy[n] * dt;
+        vx[n] = (x[n] < -1.0f || x[n] > 1.0f) ? -vx[n] : vx[n];
+        vy[n] = (y[n] < -1.0f || y[n] > 1.0f) ? -vy[n] : vy[n];
+    }
+}
+
+void Simulation::updatePlayerAttacks(const SimInput& input) {
+    PROFILE_ZONE("player attacks");
+    SimState& s = state_;
+    EntityStore& e = s.entities;
+    const int p = ENTITY_PLAYER1_PROJECTILE;
+    bool rightActive = e.alive[p] && e.vx[p] > 0.0f;
+    bool leftActive = e.alive[p] && e.vx[p] < 0.0f;
+
+    // Right attack (Z)
+    if (!leftActive && input.held(INPUT_P1_FIRE_RIGHT) && !s.fireRightHeld) {
+        s.fireRightHeld = true;
+        if (!rightActive) {
+            e.x[p] = e.x[ENTITY_PLAYER1];
+            e.y[p] = e.y[ENTITY_PLAYER1];
+            e.vx[p] = PROJECTILE_SPEED;
+            e.alive[p] = 1;
+            e.teleported[p] = 1;
+            rightActive = true;
+        }
+    }
+    if (!input.held(INPUT_P1_FIRE_RIGHT)) {
+        s.fireRightHeld = false;
+    }
+
+    // Left attack (X). Like the original, this is gated on Z being released.
+    if (!rightActive && input.held(INPUT_P1_FIRE_LEFT) && !s.fireRightHeld) {
+        if (!leftActive) {
+            e.x[p] = e.x[ENTITY_PLAYER1];
+            e.y[p] = e.y[ENTITY_PLAYER1];
+            e.vx[p] = -PROJECTILE_SPEED;
+            e.alive[p] = 1;
+            e.teleported[p] = 1;
+        }
+    }
+
+    if (e.alive[p]) {
+        e.x[p] += e.vx[p] * tickSeconds_;
+        if (e.x[p] > 1.0f || e.x[p] < -1.0f) {
+            e.alive[p] = 0;
+        }
+    }
+}
+
+void Simulation::updateEnemyProjectiles() {
+    PROFILE_ZONE("enemy projectiles");
+    SimState& s = state_;
+    EntityStore& e = s.entities;
+
+    for (int i = 0; i < s.enemyCount; i++) {
+        int n = s.enemy(i);
+        int p = s.enemyProjectile(i);
+
+        // Shoot a projectile every 0.75 seconds
+        if (s.tick - e.lastShotTick[n] >= shotIntervalTicks_) {
+            e.lastShotTick[n] = s.tick;
+            if (!e.alive[p]) {
+                e.x[p] = e.x[n];
+                e.y[p] = e.y[n];
+                randomDirectionBatch(s.seed, &e.randomStream[n], &e.randomIndex[n], 1, ENEMY_PROJECTILE_SPEED, &e.vx[p], &e.vy[p]);
+                e.alive[p] = 1;
+                e.teleported[p] = 1;
+            }
+        }
+
+        if (e.alive[p]) {
+            e.x[p] += e.vx[p] * tickSeconds_;
+            e.y[p] += e.vy[p] * tickSeconds_;
+
+            // Deactivate projectile if it goes out of bounds
+            if (e.x[p] < -1.0f || e.x[p] > 1.0f || e.y[p] < -1.0f || e.y[p] > 1.0f) {
+                e.alive[p] = 0;
+            }
+        }
+    }
+}
+
+void Simulation::resolveCollisions() {
+    PROFILE_ZONE("collision");
+    SimState& s = state_;
+    EntityStore& e = s.entities;
+    const float playerX = e.x[ENTITY_PLAYER1];
+    const float playerY = e.y[ENTITY_PLAYER1];
+
+    enemyGrid_.build(e.x, e.y, e.alive, s.enemy(0), s.enemyCount);
+    enemyProjectileGrid_.build(e.x, e.y, e.alive, s.enemyProjectile(0), s.enemyCount);
+
+    // Player 2 projectile against enemies
+    const int p2 = ENTITY_PLAYER2_PROJECTILE;
+    if (e.alive[p2]) {
+        int n = enemyGrid_.firstOverlap(e.x[p2], e.y[p2], 0.1f);
+        if (n >= 0) {
+            s.score++;
+            respawnEnemy(n, true);
+            enemyGrid_.relocate(n);
+            e.alive[p2] = 0;
+        }
+    }
+
+    // Enemy projectiles against player 1, with a smaller box than the enemy itself
+    if (enemyProjectileGrid_.firstOverlap(playerX, playerY, 0.03f) >= 0)
+        s.gameOver = true;
+
+    // Player against enemies
+    if (enemyGrid_.firstOverlap(playerX, playerY, 0.1f) >= 0)
+        s.gameOver = true;
+
+    // Player 1 projectile against enemies. Only the right attack is used up
+    // by a hit; the left attack carries on through.
+    const int p = ENTITY_PLAYER1_PROJECTILE;
+    if (e.alive[p]) {
+        int n = enemyGrid_.firstOverlap(e.x[p], e.y[p], 0.1f);
+        if (n >= 0) {
+            s.score++;
+            respawnEnemy(n, false);
+            enemyGrid_.relocate(n);
+            if (e.vx[p] > 0.0f)
+                e.alive[p] = 0;
+        }
+    }
+}
+
+// Respawn enemy at a random position, ensuring it's not where the players are
+void Simulation::respawnEnemy(int n, bool avoidPlayer2) {
+    EntityStore& e = state_.entities;
+    const float playerX = e.x[ENTITY_PLAYER1], playerY = e.y[ENTITY_PLAYER1];
+    const float player2X = e.x[ENTITY_PLAYER2], player2Y = e.y[ENTITY_PLAYER2];
+    do {
+        RandomDraw r = randomDraw(state_.seed, e.randomStream[n], e.randomIndex[n]++);
+        e.x[n] = ((int)randomBelow(r.v[0], 200) - 100) / 100.0f; // Random value between -1.0 and 1.0
+        e.y[n] = ((int)randomBelow(r.v[1], 200) - 100) / 100.0f;
+    } while ((std::abs(e.x[n] - playerX) < 0.2f && std::abs(e.y[n] - playerY) < 0.2f) ||
+             (avoidPlayer2 && std::abs(e.x[n] - player2X) < 0.2f && std::abs(e.y[n] - player2Y) < 0.2f));
+    e.teleported[n] = 1;
+}
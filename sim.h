@@ -0,0 +1,146 @@
+#pragma once
+
+// Gameplay simulation for Mystic Brawl.
+// Everything in here is plain C++ with no GLFW or OpenGL dependency so the
+// same rules can run inside the windowed game or headless on a CI box.
+
+#include <cstdint>
+#include <vector>
+
+#include "entities.h"
+#include "spatial_grid.h"
+
+// One bit per key the game reads. Player 1 has both WASD (unbounded) and the
+// arrow keys (clamped to the screen), exactly like the original input code.
+enum InputBits : uint32_t {
+    INPUT_P1_W          = 1u << 0,
+    INPUT_P1_A          = 1u << 1,
+    INPUT_P1_S          = 1u << 2,
+    INPUT_P1_D          = 1u << 3,
+    INPUT_P1_UP         = 1u << 4,
+    INPUT_P1_DOWN       = 1u << 5,
+    INPUT_P1_LEFT       = 1u << 6,
+    INPUT_P1_RIGHT      = 1u << 7,
+    INPUT_P1_FIRE_RIGHT = 1u << 8,  // Z
+    INPUT_P1_FIRE_LEFT  = 1u << 9,  // X
+    INPUT_P2_UP         = 1u << 10, // I
+    INPUT_P2_LEFT       = 1u << 11, // J
+    INPUT_P2_DOWN       = 1u << 12, // K
+    INPUT_P2_RIGHT      = 1u << 13, // L
+    INPUT_P2_FIRE_RIGHT = 1u << 14, // O
+    INPUT_P2_FIRE_LEFT  = 1u << 15  // P
+};
+
+// Key state for a single simulation step.
+struct SimInput {
+    uint32_t keys = 0;
+
+    bool held(uint32_t bit) const { return (keys & bit) != 0; }
+};
+
+const int DEFAULT_ENEMY_COUNT = 3;
+
+const uint64_t DEFAULT_SEED = 0x4D59535449430001ull;
+
+// Fixed slots at the front of the entity store; enemies and their
+// projectiles follow as two contiguous ranges.
+const int ENTITY_PLAYER1 = 0;
+const int ENTITY_PLAYER2 = 1;
+const int ENTITY_PLAYER1_PROJECTILE = 2;
+const int ENTITY_PLAYER2_PROJECTILE = 3;
+const int FIRST_ENEMY = 4;
+
+struct SimState {
+    explicit SimState(int enemyCount = DEFAULT_ENEMY_COUNT, uint64_t seed = DEFAULT_SEED);
+
+    // Ticks since the start of the game; timers count whole ticks, so they
+    // do not drift the way summed float seconds do
+    uint64_t tick = 0;
+    uint64_t seed = DEFAULT_SEED;
+    int score = 0;
+    bool gameOver = false;
+    bool directionsInitialized = false;
+
+    // Attack keys only fire on press, not while held
+    bool fireRightHeld = false;
+    bool player2LeftHeld = false;
+    bool player2RightHeld = false;
+
+    // Players, player projectiles, enemies and enemy projectiles. A player
+    // projectile's direction is the sign of its vx.
+    int enemyCount;
+    EntityStore entities;
+
+    int enemy(int i) const { return FIRST_ENEMY + i; }
+    int enemyProjectile(int i) const { return FIRST_ENEMY + enemyCount + i; }
+};
+
+const int DEFAULT_SIM_HZ = 60;
+
+// Enemy timers, in seconds of game time
+const float ENEMY_DIRECTION_INTERVAL = 2.0f;
+const float ENEMY_SHOT_INTERVAL = 0.75f;
+
+// Whole ticks in an interval at simHz, rounded to nearest and at least one
+inline uint64_t secondsToTicks(float seconds, int simHz) {
+    uint64_t ticks = (uint64_t)(seconds * simHz + 0.5f);
+    return ticks ? ticks : 1;
+}
+
+// Twice the largest hit box half-extent (0.1), so a query spans at most 2x2 cells
+const float COLLISION_CELL_SIZE = 0.2f;
+
+class Simulation {
+public:
+    // The simulation always advances in fixed ticks of 1/simHz seconds, so
+    // gameplay speed does not depend on how often the caller renders.
+    // Two simulations with the same seed, enemy count and inputs produce the
+    // same game.
+    explicit Simulation(int simHz = DEFAULT_SIM_HZ, uint64_t seed = DEFAULT_SEED, int enemyCount = DEFAULT_ENEMY_COUNT)
+        : tickSeconds_(1.0f / simHz), enemyCount_(enemyCount),
+          directionIntervalTicks_(secondsToTicks(ENEMY_DIRECTION_INTERVAL, simHz)),
+          shotIntervalTicks_(secondsToTicks(ENEMY_SHOT_INTERVAL, simHz)),
+          enemyGrid_(COLLISION_CELL_SIZE), enemyProjectileGrid_(COLLISION_CELL_SIZE) { reset(seed); }
+
+    // Advance the game by exactly one tick: update() then resolveCollisions().
+    void step(const SimInput& input) { update(input); resolveCollisions(); }
+
+    // The two halves of a tick, exposed so benchmarks can time them apart.
+    // Movement, AI, firing and projectile flight.
+    void update(const SimInput& input);
+    // Every hit test, scoring, respawns and game over. All queries go through
+    // spatial hash grids rebuilt here once per tick.
+    void resolveCollisions();
+
+    // Back to the starting layout, keeping nothing from the previous game.
+    void reset(uint64_t seed) { state_ = SimState(enemyCount_, seed); previous_ = state_; }
+    void reset() { reset(state_.seed); }
+
+    float tickSeconds() const { return tickSeconds_; }
+    const SimState& state() const { return state_; }
+    // Positions and alive flags from before the last step, for interpolating
+    // between ticks when rendering. Only the hot entity data is kept.
+    const SimState& previousState() const { return previous_; }
+
+private:
+    void movePlayers(const SimInput& input);
+    void updatePlayer2Attacks(const SimInput& input);
+    void updateEnemies();
+    void updatePlayerAttacks(const SimInput& input);
+    void updateEnemyProjectiles();
+    void respawnEnemy(int n, bool avoidPlayer2);
+
+    float tickSeconds_;
+    int enemyCount_;
+    uint64_t directionIntervalTicks_;
+    uint64_t shotIntervalTicks_;
+    // Scratch for batching direction changes
+    std::vector<uint32_t> dueEnemies_;
+    std::vector<uint32_t> dueStreams_;
+    std::vector<uint64_t> dueIndices_;
+    std::vector<float> dueX_, dueY_;
+    SpatialHashGrid enemyGrid_;
+    SpatialHashGrid enemyProjectileGrid_;
+    SimState state_;
+    SimState previous_;
+};
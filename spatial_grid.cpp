@@ -0,0 +1,126 @@
+#include "spatial_grid.h"
+
+#include <cmath>
+
+SpatialHashGrid::SpatialHashGrid(float cellSize)
+    : cellSize_(cellSize), inverseCellSize_(1.0f / cellSize) {}
+
+int SpatialHashGrid::cellOf(float v) const {
+    // floor() without the libm call; positions stay far inside int range
+    float scaled = v * inverseCellSize_;
+    int cell = (int)scaled;
+    return cell - (scaled < (float)cell);
+}
+
+uint32_t SpatialHashGrid::bucketOf(int cx, int cy) const {
+    return (((uint32_t)cx * 73856093u) ^ ((uint32_t)cy * 19349663u)) & mask_;
+}
+
+void SpatialHashGrid::build(const float* x, const float* y, const uint8_t* alive, int first, int count) {
+    x_ = x;
+    y_ = y;
+    first_ = first;
+    kernel_ = overlapKernel();
+    tested_ = 0;
+    overflow_.clear();
+    relocated_.assign(count, 0);
+
+    // At least as many buckets as entities keeps chains short
+    uint32_t buckets = 16;
+    while (buckets < (uint32_t)count)
+        buckets <<= 1;
+    mask_ = buckets - 1;
+
+    // Counting sort: size each bucket, prefix sum, then scatter. Dead
+    // entities get the out-of-range bucket and are left out.
+    bucketStart_.assign(buckets + 1, 0);
+    entityBucket_.resize(count);
+    for (int i = 0; i < count; i++) {
+        int n = first + i;
+        uint32_t b = alive[n] ? bucketOf(cellOf(x[n]), cellOf(y[n])) : buckets;
+        entityBucket_[i] = b;
+        if (b < buckets)
+            bucketStart_[b + 1]++;
+    }
+    for (uint32_t b = 0; b < buckets; b++)
+        bucketStart_[b + 1] += bucketStart_[b];
+
+    const uint32_t total = bucketStart_[buckets];
+    entries_.resize(total);
+    entryX_.resize(total + OVERLAP_BLOCK);
+    entryY_.resize(total + OVERLAP_BLOCK);
+    cursor_.assign(bucketStart_.begin(), bucketStart_.end() - 1);
+    for (int i = 0; i < count; i++) {
+        uint32_t b = entityBucket_[i];
+        if (b < buckets) {
+            uint32_t k = cursor_[b]++;
+            entries_[k] = first + i;
+            entryX_[k] = x[first + i];
+            entryY_[k] = y[first + i];
+        }
+    }
+}
+
+void SpatialHashGrid::relocate(int n) {
+    uint8_t& moved = relocated_[n - first_];
+    if (!moved) {
+        moved = 1;
+        overflow_.push_back(n);
+    }
+}
+
+int SpatialHashGrid::firstOverlap(float px, float py, float half) const {
+    int best = -1;
+
+    // Visit each distinct bucket under the query box once. Buckets are in
+    // ascending entity order, so each scan can stop at its first valid hit.
+    const int minCx = cellOf(px - half), maxCx = cellOf(px + half);
+    const int minCy = cellOf(py - half), maxCy = cellOf(py + half);
+    uint32_t visited[16];
+    int visitedCount = 0;
+    for (int cy = minCy; cy <= maxCy; cy++) {
+        for (int cx = minCx; cx <= maxCx; cx++) {
+            uint32_t b = bucketOf(cx, cy);
+            bool seen = false;
+            for (int v = 0; v < visitedCount; v++)
+                seen |= visited[v] == b;
+            if (seen)
+                continue;
+            if (visitedCount < 16)
+                visited[visitedCount++] = b;
+
+            // Narrow phase, a block of candidates per kernel call
+            const uint32_t end = bucketStart_[b + 1];
+            bool done = false;
+            for (uint32_t k = bucketStart_[b]; k < end && !done; k += OVERLAP_BLOCK) {
+                int count = end - k < (uint32_t)OVERLAP_BLOCK ? (int)(end - k) : OVERLAP_BLOCK;
+                tested_ += count;
+                uint32_t hits = kernel_(&entryX_[k], &entryY_[k], count, px, py, half);
+                while (hits) {
+                    int n = entries_[k + __builtin_ctz(hits)];
+                    hits &= hits - 1;
+                    if (best >= 0 && n >= best) {
+                        done = true;
+                        break;
+                    }
+                    // A relocated entity's copy here is stale; it is tested
+                    // from the overflow list instead
+                    if (!relocated_[n - first_]) {
+                        best = n;
+                        done = true;
+                        break;
+                    }
+                }
+                if (best >= 0 && k + OVERLAP_BLOCK < end && entries_[k + OVERLAP_BLOCK] >= best)
+                    done = true;
+            }
+        }
+    }
+
+    for (int n : overflow_) {
+        tested_++;
+        if (std::abs(px - x_[n]) < half && std::abs(py - y_[n]) < half && (best < 0 || n < best))
+            best = n;
+    }
+    return best;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+// Uniform spatial hash grid used as the broadphase for every hit test.
+//
+// Entities are bucketed by the cell they sit in; cells are hashed into a
+// power-of-two table, so the world does not need fixed bounds. The table is
+// rebuilt from the entity store once per tick with a counting sort, which
+// keeps each bucket contiguous. Entities that move after the build (a
+// respawn, say) are relocated into a small overflow list instead of forcing
+// a rebuild. Positions are copied into bucket order too, so the narrow
+// phase can run the SIMD kernels from collide_simd.h over each bucket.
+
+#include <cstdint>
+#include <vector>
+
+#include "collide_simd.h"
+
+class SpatialHashGrid {
+public:
+    // cellSize should be at least twice the largest query half-extent so a
+    // query touches no more than 2x2 cells.
+    explicit SpatialHashGrid(float cellSize);
+
+    // Bucket the live entities in [first, first + count) by position
+    void build(const float* x, const float* y, const uint8_t* alive, int first, int count);
+
+    // Entity n was moved after build(); x/y must already hold its new position
+    void relocate(int n);
+
+    // Lowest-index entity whose position is within half of (px, py) on both
+    // axes (the same |dx| < half && |dy| < half test as the old loops), or -1.
+    int firstOverlap(float px, float py, float half) const;
+
+    // Number of entities tested by queries since the last build
+    long candidatesTested() const { return tested_; }
+
+private:
+    uint32_t bucketOf(int cx, int cy) const;
+    int cellOf(float v) const;
+
+    float cellSize_;
+    float inverseCellSize_;
+    uint32_t mask_ = 0;
+
+    // Positions the grid was built from
+    const float* x_ = nullptr;
+    const float* y_ = nullptr;
+    int first_ = 0;
+    OverlapKernel kernel_ = nullptr;
+
+    std::vector<uint32_t> bucketStart_; // mask_ + 2 prefix sums
+    std::vector<int> entries_;          // entity indices grouped by bucket, ascending
+    std::vector<float> entryX_, entryY_; // their positions, padded for the kernels
+    std::vector<uint32_t> cursor_;
+    std::vector<uint32_t> entityBucket_;
+    std::vector<uint8_t> relocated_;    // per entity, relative to first_
+    std::vector<int> overflow_;         // relocated entities, checked by every query
+    mutable long tested_ = 0;
+};
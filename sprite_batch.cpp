@@ -0,0 +1,162 @@
+#include "sprite_batch.h"
+
+#include <glad/glad.h>
+
+#include "atlas.h"
+#include "gl_state.h"
+
+SpriteBatch::~SpriteBatch() {
+    if (vao_)
+        glDeleteVertexArrays(1, &vao_);
+    if (quadVbo_)
+        glDeleteBuffers(1, &quadVbo_);
+    if (ebo_)
+        glDeleteBuffers(1, &ebo_);
+}
+
+void SpriteBatch::init(const SpriteBatchOptions& options) {
+    vertexIdQuads_ = options.vertexIdQuads;
+    textureArrays_ = options.textureArrays;
+    glGenVertexArrays(1, &vao_);
+    glBindVertexArray(vao_);
+
+    if (!vertexIdQuads_) {
+        // Unit quad, scaled and moved per instance
+        float quadVertices[] = {
+            -1.0f,  1.0f, 0.0f,  0.0f, 1.0f,  // top left
+            -1.0f, -1.0f, 0.0f,  0.0f, 0.0f,  // bottom left
+             1.0f, -1.0f, 0.0f,  1.0f, 0.0f,  // bottom right
+             1.0f,  1.0f, 0.0f,  1.0f, 1.0f   // top right
+        };
+        unsigned int indices[] = { 0, 1, 2, 0, 2, 3 };
+
+        glGenBuffers(1, &quadVbo_);
+        glGenBuffers(1, &ebo_);
+        glBindBuffer(GL_ARRAY_BUFFER, quadVbo_);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), quadVertices, GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo_);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
+        glEnableVertexAttribArray(1);
+    }
+
+    stream_.init(options.initialCapacity * sizeof(SpriteBatchInstance), options.persistentBuffers);
+    for (unsigned int attrib = 2; attrib <= 5; attrib++) {
+        glEnableVertexAttribArray(attrib);
+        glVertexAttribDivisor(attrib, 1);
+    }
+
+    glBindVertexArray(0);
+}
+
+void SpriteBatch::begin() {
+    instances_.clear();
+    queue_.clear();
+    textures_.clear();
+    lastTexture_ = 0;
+    drawLayer_ = 0;
+}
+
+void SpriteBatch::add(unsigned int texture, float x, float y, float scale,
+                      const AtlasRegion* region, float layer) {
+    // Textures get small indices for the sort key in first-use order.
+    // Sprites of one texture usually arrive together, so check the last
+    // one before searching.
+    size_t t = lastTexture_;
+    if (t >= textures_.size() || textures_[t] != texture) {
+        for (t = 0; t < textures_.size() && textures_[t] != texture; t++) {}
+        if (t == textures_.size())
+            textures_.push_back(texture);
+        lastTexture_ = t;
+    }
+
+    queue_.push(makeRenderKey(drawLayer_, 0, (uint32_t)t, 0), (uint32_t)instances_.size());
+    if (region)
+        instances_.push_back({ x, y, scale, layer, region->u0, region->v0, region->u1, region->v1 });
+    else
+        instances_.push_back({ x, y, scale, layer, 0.0f, 0.0f, 1.0f, 1.0f });
+}
+
+int SpriteBatch::flush(GlStateCache& state) {
+    if (!upload(state))
+        return 0;
+    int drawCalls = drawRange(state, 0, queue_.size());
+    finish();
+    return drawCalls;
+}
+
+bool SpriteBatch::upload(GlStateCache& state) {
+    const size_t total = queue_.size();
+    if (total == 0)
+        return false;
+    queue_.sort();
+
+    // Gather the instances in key order straight into the stream buffer
+    state.bindVertexArray(vao_);
+    SpriteBatchInstance* out = (SpriteBatchInstance*)stream_.map(state, total * sizeof(SpriteBatchInstance));
+    if (!out)
+        return false;
+    for (size_t i = 0; i < total; i++)
+        out[i] = instances_[queue_.item(i)];
+    uploadStart_ = stream_.unmap();
+    return true;
+}
+
+int SpriteBatch::drawLayer(GlStateCache& state, uint32_t layer) {
+    return drawRange(state, layerStart(layer), layerStart(layer + 1));
+}
+
+void SpriteBatch::finish() {
+    stream_.fence();
+}
+
+size_t SpriteBatch::layerStart(uint32_t layer) const {
+    // The layer is the top byte of the sorted keys
+    size_t lo = 0, hi = queue_.size();
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (renderKeyLayer(queue_.key(mid)) < layer)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+int SpriteBatch::drawRange(GlStateCache& state, size_t first, size_t end) {
+    // One draw per run of equal texture. A change of layer alone does not
+    // split a run: instances draw in order, so the layering still holds.
+    // GL 3.3 has no base instance, so each run re-points the instance
+    // attributes at its slice of the buffer.
+    int drawCalls = 0;
+    const GLsizei stride = sizeof(SpriteBatchInstance);
+    state.bindVertexArray(vao_);
+    state.bindArrayBuffer(stream_.buffer());
+    while (first < end) {
+        const uint32_t texture = renderKeyTexture(queue_.key(first));
+        size_t runEnd = first + 1;
+        while (runEnd < end && renderKeyTexture(queue_.key(runEnd)) == texture)
+            runEnd++;
+
+        const char* base = (const char*)(uploadStart_ + first * sizeof(SpriteBatchInstance));
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, base);
+        glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, stride, base + 2 * sizeof(float));
+        glVertexAttribPointer(4, 1, GL_FLOAT, GL_FALSE, stride, base + 3 * sizeof(float));
+        glVertexAttribPointer(5, 4, GL_FLOAT, GL_FALSE, stride, base + 4 * sizeof(float));
+
+        if (textureArrays_)
+            state.bindTexture2DArray(textures_[texture]);
+        else
+            state.bindTexture2D(textures_[texture]);
+        if (vertexIdQuads_)
+            glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, (GLsizei)(runEnd - first));
+        else
+            glDrawElementsInstanced(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0, (GLsizei)(runEnd - first));
+        drawCalls++;
+        first = runEnd;
+    }
+    return drawCalls;
+}
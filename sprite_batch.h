@@ -0,0 +1,94 @@
+#pragma once
+
+// Instanced sprite renderer.
+//
+// Sprites are queued with add() under a render-queue sort key (draw layer,
+// then texture). flush() radix-sorts the keys, writes every instance
+// (offset, scale, texture layer, UV rect) into one buffer in that order and
+// issues a single instanced draw per run of one texture, instead of a
+// uniform update, texture bind and draw call per sprite. Draw layers come
+// out in increasing order, textures within a layer in the order they were
+// first added, and sprites with equal keys in the order they were added.
+//
+// Expects a program with the unit quad at attribute locations 0/1 and the
+// per-instance data at 2 (vec2 offset), 3 (float scale), 4 (float layer) and
+// 5 (vec4 UV rectangle: u0, v0, u1, v1). With vertexIdQuads the quad buffers
+// are dropped and the program (the VERTEX_ID shader variant) must build the
+// corners from gl_VertexID; each batch is then a 4-vertex instanced strip.
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "render_queue.h"
+#include "stream_buffer.h"
+
+class GlStateCache;
+struct AtlasRegion;
+
+struct SpriteBatchInstance {
+    float x, y;
+    float scale;
+    float layer;
+    float u0, v0, u1, v1;
+};
+
+struct SpriteBatchOptions {
+    size_t initialCapacity = 1024; // instances
+    bool persistentBuffers = true; // false forces the StreamBuffer fallback
+    bool vertexIdQuads = false;
+    bool textureArrays = false; // textures are GL_TEXTURE_2D_ARRAYs, picked by layer
+};
+
+class SpriteBatch {
+public:
+    SpriteBatch() = default;
+    ~SpriteBatch();
+    SpriteBatch(const SpriteBatch&) = delete;
+    SpriteBatch& operator=(const SpriteBatch&) = delete;
+
+    // Needs a current GL context, which must still be current when the
+    // batch is destroyed. Instances stream through a StreamBuffer.
+    void init(const SpriteBatchOptions& options = SpriteBatchOptions());
+
+    void begin();
+    // Draw layer for the following add() calls; lower layers draw first
+    void setDrawLayer(uint32_t layer) { drawLayer_ = layer; }
+    // region selects part of an atlas texture; nullptr draws the whole texture
+    void add(unsigned int texture, float x, float y, float scale,
+             const AtlasRegion* region = nullptr, float layer = 0.0f);
+
+    // Draw everything queued since begin() with the currently bound program,
+    // binding through state. Returns the number of draw calls issued.
+    int flush(GlStateCache& state);
+
+    // flush() in steps, for callers that time or interleave draw layers:
+    // upload() sorts and streams the instances, drawLayer() draws one layer
+    // (any number of times, in any order) and finish() fences the upload
+    // once every draw has been issued. upload() returns false if the
+    // instance buffer cannot be mapped; draw nothing then.
+    bool upload(GlStateCache& state);
+    int drawLayer(GlStateCache& state, uint32_t layer);
+    void finish();
+
+    const StreamBuffer& stream() const { return stream_; }
+
+private:
+    // Draws sorted instances [first, end), one call per texture run
+    int drawRange(GlStateCache& state, size_t first, size_t end);
+    size_t layerStart(uint32_t layer) const;
+
+    std::vector<SpriteBatchInstance> instances_; // in add() order
+    RenderQueue queue_;
+    std::vector<unsigned int> textures_; // sort key texture index -> GL name
+    size_t lastTexture_ = 0;
+    uint32_t drawLayer_ = 0;
+    size_t uploadStart_ = 0; // buffer offset of this frame's instances
+
+    bool vertexIdQuads_ = false;
+    bool textureArrays_ = false;
+    unsigned int vao_ = 0;
+    unsigned int quadVbo_ = 0; // both 0 with vertexIdQuads
+    unsigned int ebo_ = 0;
+    StreamBuffer stream_;
+};
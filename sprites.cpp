@@ -0,0 +1,96 @@
+#include "sprites.h"
+
+#include <cstring>
+
+#if defined(__SSE2__)
+#define MYSTIC_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+void emitSprite(const EntityStore& cur, int n, int firstEnemy, float x, float y, std::vector<SpriteInstance>& out) {
+    SpriteInstance sprite;
+    sprite.x = x;
+    sprite.y = y;
+    sprite.type = cur.type[n];
+    sprite.variant = cur.type[n] == ENTITY_ENEMY ? (uint16_t)((n - firstEnemy) % ENEMY_VARIANTS) : 0;
+    out.push_back(sprite);
+}
+
+}
+
+CullStats collectSprites(const EntityStore& prev, const EntityStore& cur, int firstEnemy, float alpha,
+                         const ViewRect& view, std::vector<SpriteInstance>& out) {
+    const int count = (int)cur.size();
+    const size_t first = out.size();
+    int live = 0;
+    int n = 0;
+
+#ifdef MYSTIC_SSE2
+    // SSE2 is part of x86-64, so this needs no runtime check. Each block
+    // interpolates four positions, tests them against the view and only
+    // emits the lanes that are alive and visible.
+    const __m128 vAlpha = _mm_set1_ps(alpha);
+    const __m128 minX = _mm_set1_ps(view.minX), maxX = _mm_set1_ps(view.maxX);
+    const __m128 minY = _mm_set1_ps(view.minY), maxY = _mm_set1_ps(view.maxY);
+    const __m128i zero = _mm_setzero_si128();
+    for (; n + 4 <= count; n += 4) {
+        // Alive flags are bytes; widen four of them to a lane mask
+        int curAlive, prevAlive, teleported;
+        memcpy(&curAlive, cur.alive + n, 4);
+        memcpy(&prevAlive, prev.alive + n, 4);
+        memcpy(&teleported, cur.teleported + n, 4);
+        int aliveBits = ~_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_cvtsi32_si128(curAlive), zero)) & 0xF;
+        if (!aliveBits)
+            continue;
+        live += __builtin_popcount(aliveBits);
+        // Snap lanes that were dead last tick or teleported this one
+        __m128i stay = _mm_unpacklo_epi16(
+            _mm_unpacklo_epi8(_mm_cvtsi32_si128(prevAlive & ~teleported), zero), zero);
+        __m128 snap = _mm_castsi128_ps(_mm_cmpeq_epi32(stay, zero));
+
+        __m128 cx = _mm_loadu_ps(cur.x + n), cy = _mm_loadu_ps(cur.y + n);
+        __m128 px = _mm_loadu_ps(prev.x + n), py = _mm_loadu_ps(prev.y + n);
+        __m128 dx = _mm_sub_ps(cx, px), dy = _mm_sub_ps(cy, py);
+        __m128 ix = _mm_add_ps(px, _mm_mul_ps(dx, vAlpha));
+        __m128 iy = _mm_add_ps(py, _mm_mul_ps(dy, vAlpha));
+        ix = _mm_or_ps(_mm_and_ps(snap, cx), _mm_andnot_ps(snap, ix));
+        iy = _mm_or_ps(_mm_and_ps(snap, cy), _mm_andnot_ps(snap, iy));
+
+        __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(ix, minX), _mm_cmple_ps(ix, maxX)),
+                                   _mm_and_ps(_mm_cmpge_ps(iy, minY), _mm_cmple_ps(iy, maxY)));
+        int visible = _mm_movemask_ps(inside) & aliveBits;
+        if (!visible)
+            continue;
+
+        float xs[4], ys[4];
+        _mm_storeu_ps(xs, ix);
+        _mm_storeu_ps(ys, iy);
+        for (; visible; visible &= visible - 1) {
+            int lane = __builtin_ctz(visible);
+            emitSprite(cur, n + lane, firstEnemy, xs[lane], ys[lane], out);
+        }
+    }
+#endif
+
+    for (; n < count; n++) {
+        if (!cur.alive[n])
+            continue;
+        live++;
+
+        float dx = cur.x[n] - prev.x[n];
+        float dy = cur.y[n] - prev.y[n];
+        bool snap = !prev.alive[n] || cur.teleported[n];
+        float x = snap ? cur.x[n] : prev.x[n] + dx * alpha;
+        float y = snap ? cur.y[n] : prev.y[n] + dy * alpha;
+        if (x < view.minX || x > view.maxX || y < view.minY || y > view.maxY)
+            continue;
+        emitSprite(cur, n, firstEnemy, x, y, out);
+    }
+
+    CullStats stats;
+    stats.submitted = (int)(out.size() - first);
+    stats.culled = live - stats.submitted;
+    return stats;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+// GL-free list of sprites to draw this frame, built from the entity store.
+// Keeping this step separate from GL submission lets headless benchmarks
+// time the CPU side of rendering.
+
+#include <cstdint>
+#include <vector>
+
+#include "entities.h"
+
+struct SpriteInstance {
+    float x, y;
+    uint16_t type;    // EntityType
+    uint16_t variant; // which texture of that type, e.g. enemy skin
+};
+
+// Number of enemy texture variants; enemy i uses variant i % ENEMY_VARIANTS
+const int ENEMY_VARIANTS = 3;
+
+// Axis-aligned rectangle of sprite centres that can reach the screen: the
+// visible area grown by the largest sprite half-extent
+struct ViewRect {
+    float minX, minY, maxX, maxY;
+};
+
+// Live sprites kept and dropped by one collectSprites call
+struct CullStats {
+    int submitted = 0;
+    int culled = 0;
+};
+
+// Append every live entity whose position falls inside view, interpolated
+// between the last two ticks. Entities that were not alive last tick or
+// teleported during it (respawns, new projectiles) are snapped. Positions
+// are tested four at a time with SSE2 where available.
+CullStats collectSprites(const EntityStore& prev, const EntityStore& cur, int firstEnemy, float alpha,
+                         const ViewRect& view, std::vector<SpriteInstance>& out);
@@ -0,0 +1,106 @@
+#include "stream_buffer.h"
+
+#include <glad/glad.h>
+
+#include "gl_state.h"
+
+namespace {
+
+// Keeps every region start suitably aligned for any vertex attribute
+const size_t REGION_ALIGNMENT = 256;
+
+size_t alignRegion(size_t bytes) {
+    return (bytes + REGION_ALIGNMENT - 1) / REGION_ALIGNMENT * REGION_ALIGNMENT;
+}
+
+}
+
+void StreamBuffer::init(size_t regionBytes, bool allowPersistent) {
+    allowPersistent_ = allowPersistent;
+    create(regionBytes);
+}
+
+void StreamBuffer::create(size_t regionBytes) {
+    regionBytes_ = alignRegion(regionBytes);
+    region_ = 0;
+    persistent_ = allowPersistent_ && GLAD_GL_VERSION_4_4 && glBufferStorage;
+
+    glGenBuffers(1, &buffer_);
+    glBindBuffer(GL_ARRAY_BUFFER, buffer_);
+    if (persistent_) {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_ARRAY_BUFFER, regionBytes_ * STREAM_REGIONS, nullptr, flags);
+        mapped_ = glMapBufferRange(GL_ARRAY_BUFFER, 0, regionBytes_ * STREAM_REGIONS, flags);
+        if (!mapped_) {
+            // Storage is immutable now, so start over with a plain buffer
+            glDeleteBuffers(1, &buffer_);
+            glGenBuffers(1, &buffer_);
+            glBindBuffer(GL_ARRAY_BUFFER, buffer_);
+            persistent_ = false;
+        }
+    }
+    if (!persistent_)
+        glBufferData(GL_ARRAY_BUFFER, regionBytes_ * STREAM_REGIONS, nullptr, GL_STREAM_DRAW);
+}
+
+void StreamBuffer::destroy() {
+    for (void*& f : fences_) {
+        if (f)
+            glDeleteSync((GLsync)f);
+        f = nullptr;
+    }
+    if (persistent_ && mapped_) {
+        glBindBuffer(GL_ARRAY_BUFFER, buffer_);
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+    }
+    mapped_ = nullptr;
+    glDeleteBuffers(1, &buffer_);
+    buffer_ = 0;
+}
+
+void* StreamBuffer::map(GlStateCache& state, size_t bytes) {
+    if (bytes > regionBytes_) {
+        // Draws still queued keep the old buffer alive inside the driver
+        size_t grown = regionBytes_;
+        while (grown < bytes)
+            grown *= 2;
+        destroy();
+        create(grown);
+        state.forgetArrayBuffer(); // bound behind the cache's back
+    }
+    state.bindArrayBuffer(buffer_);
+
+    // Wait until the GPU has finished reading this region's last contents
+    if (GLsync f = (GLsync)fences_[region_]) {
+        GLenum result = glClientWaitSync(f, 0, 0);
+        if (result == GL_TIMEOUT_EXPIRED) {
+            stalls_++;
+            do {
+                result = glClientWaitSync(f, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+            } while (result == GL_TIMEOUT_EXPIRED);
+        }
+        glDeleteSync(f);
+        fences_[region_] = nullptr;
+    }
+
+    size_t offset = (size_t)region_ * regionBytes_;
+    if (persistent_)
+        return (char*)mapped_ + offset;
+    // Orphan when the ring wraps, then write unsynchronized: the fences
+    // already keep the CPU off regions the GPU is reading
+    if (region_ == 0)
+        glBufferData(GL_ARRAY_BUFFER, regionBytes_ * STREAM_REGIONS, nullptr, GL_STREAM_DRAW);
+    return glMapBufferRange(GL_ARRAY_BUFFER, offset, bytes,
+                            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+}
+
+size_t StreamBuffer::unmap() {
+    if (!persistent_)
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+    return (size_t)region_ * regionBytes_;
+}
+
+void StreamBuffer::fence() {
+    fences_[region_] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    region_ = (region_ + 1) % STREAM_REGIONS;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+// Ring buffer for data rewritten every frame (sprite instances).
+//
+// The buffer is split into STREAM_REGIONS regions used in turn, each guarded
+// by a fence, so the CPU fills region N+1 while the GPU still reads region
+// N. On GL 4.4 the whole buffer is created with glBufferStorage and mapped
+// once, persistently and coherently; writes go straight into it. Older
+// contexts fall back to orphaning the buffer and mapping it with
+// glMapBufferRange every use.
+
+#include <cstddef>
+#include <cstdint>
+
+class GlStateCache;
+
+const int STREAM_REGIONS = 3;
+
+class StreamBuffer {
+public:
+    StreamBuffer() = default;
+    ~StreamBuffer() { if (buffer_) destroy(); }
+    StreamBuffer(const StreamBuffer&) = delete;
+    StreamBuffer& operator=(const StreamBuffer&) = delete;
+
+    // Needs a current GL context. allowPersistent = false forces the
+    // orphaning path, for comparison.
+    void init(size_t regionBytes, bool allowPersistent = true);
+
+    // Writable space for bytes bytes, binding the buffer to GL_ARRAY_BUFFER.
+    // May wait for the GPU to finish with the region, or grow the buffer.
+    // Returns nullptr if the driver cannot map it; skip unmap() then.
+    void* map(GlStateCache& state, size_t bytes);
+    // Finish writing; returns the buffer offset the data starts at
+    size_t unmap();
+    // Call after the draws that read the mapped data have been issued
+    void fence();
+
+    unsigned int buffer() const { return buffer_; }
+    bool persistent() const { return persistent_; }
+    // Times map() had to wait for the GPU
+    uint64_t stalls() const { return stalls_; }
+
+private:
+    void create(size_t regionBytes);
+    void destroy();
+
+    unsigned int buffer_ = 0;
+    bool persistent_ = false;
+    bool allowPersistent_ = true;
+    size_t regionBytes_ = 0;
+    int region_ = 0;
+    void* mapped_ = nullptr; // whole buffer when persistent
+    void* fences_[STREAM_REGIONS] = {}; // GLsync
+    uint64_t stalls_ = 0;
+};
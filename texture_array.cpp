@@ -0,0 +1,114 @@
+#include "texture_array.h"
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#include "asset_cache.h"
+
+namespace {
+
+// Bilinear resample to RGBA8; sources without alpha come out opaque
+std::vector<unsigned char> resampleToRgba(const unsigned char* src, int width, int height, int channels,
+                                          int newWidth, int newHeight) {
+    std::vector<unsigned char> dst((size_t)newWidth * newHeight * 4, 255);
+    const float sx = (float)width / newWidth;
+    const float sy = (float)height / newHeight;
+    for (int y = 0; y < newHeight; y++) {
+        // Sample at texel centres, clamped to the edge
+        float fy = std::min(std::max((y + 0.5f) * sy - 0.5f, 0.0f), (float)(height - 1));
+        int y0 = (int)fy;
+        int y1 = std::min(y0 + 1, height - 1);
+        float ty = fy - y0;
+        for (int x = 0; x < newWidth; x++) {
+            float fx = std::min(std::max((x + 0.5f) * sx - 0.5f, 0.0f), (float)(width - 1));
+            int x0 = (int)fx;
+            int x1 = std::min(x0 + 1, width - 1);
+            float tx = fx - x0;
+            for (int c = 0; c < channels; c++) {
+                float top = src[((size_t)y0 * width + x0) * channels + c] * (1.0f - tx) + src[((size_t)y0 * width + x1) * channels + c] * tx;
+                float bottom = src[((size_t)y1 * width + x0) * channels + c] * (1.0f - tx) + src[((size_t)y1 * width + x1) * channels + c] * tx;
+                dst[((size_t)y * newWidth + x) * 4 + c] = (unsigned char)std::lround(top * (1.0f - ty) + bottom * ty);
+            }
+        }
+    }
+    return dst;
+}
+
+int mipLevels(int width, int height) {
+    int levels = 1;
+    while ((width | height) >> levels)
+        levels++;
+    return levels;
+}
+
+}
+
+TextureArray::~TextureArray() {
+    if (texture_)
+        glDeleteTextures(1, &texture_);
+}
+
+bool TextureArray::load(TextureCache& cache, const std::vector<std::string>& paths) {
+    std::vector<TexturePixels> images(paths.size());
+    int width = 0, height = 0;
+    for (size_t i = 0; i < paths.size(); i++) {
+        if (!cache.pixels(paths[i], images[i]) || (images[i].channels != 3 && images[i].channels != 4)) {
+            std::cerr << "No pixels for texture array layer: " << paths[i] << "\n";
+            return false;
+        }
+        width = std::max(width, images[i].width);
+        height = std::max(height, images[i].height);
+    }
+
+    // Packed layers at full size bring their mips; if every layer does,
+    // they are uploaded as they are instead of regenerated
+    const int levels = mipLevels(width, height);
+    bool storedMips = true;
+    for (const TexturePixels& image : images) {
+        storedMips = storedMips && image.width == width && image.height == height && image.channels == 4 &&
+                     (int)image.levels.size() == levels;
+    }
+
+    if (texture_)
+        glDeleteTextures(1, &texture_);
+    glGenTextures(1, &texture_);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texture_);
+    for (int level = 0; level < (storedMips ? levels : 1); level++) {
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, level, GL_RGBA8, std::max(width >> level, 1), std::max(height >> level, 1),
+                     (GLsizei)images.size(), 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    }
+    for (size_t i = 0; i < images.size(); i++) {
+        const TexturePixels& image = images[i];
+        if (storedMips) {
+            for (int level = 0; level < levels; level++) {
+                glTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, (GLint)i, std::max(width >> level, 1),
+                                std::max(height >> level, 1), 1, GL_RGBA, GL_UNSIGNED_BYTE, image.levels[level]);
+            }
+        } else if (image.width == width && image.height == height && image.channels == 4) {
+            glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, (GLint)i, width, height, 1,
+                            GL_RGBA, GL_UNSIGNED_BYTE, image.levels[0]);
+        } else {
+            std::vector<unsigned char> layer = resampleToRgba(image.levels[0], image.width, image.height,
+                                                              image.channels, width, height);
+            glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, (GLint)i, width, height, 1,
+                            GL_RGBA, GL_UNSIGNED_BYTE, layer.data());
+        }
+    }
+    // Otherwise mips are generated per layer
+    if (storedMips)
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, levels - 1);
+    else
+        glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    width_ = width;
+    height_ = height;
+    layers_ = (int)images.size();
+    return true;
+}
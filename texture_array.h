@@ -0,0 +1,38 @@
+#pragma once
+
+// Sprite textures as layers of one GL_TEXTURE_2D_ARRAY.
+//
+// Unlike an atlas, every layer gets its own mip chain with nothing to bleed
+// in from a neighbour, and a shader picks the layer per instance, so sprites
+// with different images still draw in one call with no texture rebinding.
+// Layers must share a size, so the array takes the largest width and height
+// among the images and resamples any smaller image up to it; sprite quads
+// stretch each layer over the whole quad anyway.
+
+#include <string>
+#include <vector>
+
+class TextureCache;
+
+class TextureArray {
+public:
+    TextureArray() = default;
+    ~TextureArray();
+    TextureArray(const TextureArray&) = delete;
+    TextureArray& operator=(const TextureArray&) = delete;
+
+    // Build layers 0..n-1 from the cache's pixels for paths, which must be
+    // acquired with keepPixels set. Needs a current GL context, which must
+    // still be current when the array is destroyed. Prints an error and
+    // returns false if any layer's pixels are missing.
+    bool load(TextureCache& cache, const std::vector<std::string>& paths);
+
+    unsigned int texture() const { return texture_; }
+    int width() const { return width_; }
+    int height() const { return height_; }
+    int layers() const { return layers_; }
+
+private:
+    unsigned int texture_ = 0;
+    int width_ = 0, height_ = 0, layers_ = 0;
+};